@@ -70,9 +70,14 @@ typedef struct EvalContext {
     uint64_t n;
     double var_values[VAR_VARS_NB];
     double *channel_values;
+    int *channel_uses_val;      ///< whether the expression of each output channel calls val()
+    int uses_val;               ///< whether any expression calls val()
     int64_t out_channel_layout;
 } EvalContext;
 
+/* number of samples evaluated with one av_expr_eval_array() call */
+#define EVAL_BATCH 256
+
 static double val(void *priv, double ch)
 {
     EvalContext *eval = priv;
@@ -218,6 +223,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     }
     av_freep(&eval->expr);
     av_freep(&eval->channel_values);
+    av_freep(&eval->channel_uses_val);
 }
 
 static int config_props(AVFilterLink *outlink)
@@ -275,7 +281,9 @@ static int request_frame(AVFilterLink *outlink)
 {
     EvalContext *eval = outlink->src->priv;
     AVFrame *samplesref;
-    int i, j;
+    double ns[EVAL_BATCH], ts[EVAL_BATCH];
+    const double *arrays[VAR_VARS_NB] = { [VAR_N] = ns, [VAR_T] = ts };
+    int i, j, k, ret;
     int64_t t = av_rescale(eval->n, AV_TIME_BASE, eval->sample_rate);
     int nb_samples;
 
@@ -294,14 +302,22 @@ static int request_frame(AVFilterLink *outlink)
         return AVERROR(ENOMEM);
 
     /* evaluate expression for each single sample and for each channel */
-    for (i = 0; i < nb_samples; i++, eval->n++) {
-        eval->var_values[VAR_N] = eval->n;
-        eval->var_values[VAR_T] = eval->var_values[VAR_N] * (double)1/eval->sample_rate;
+    for (i = 0; i < nb_samples; i += EVAL_BATCH) {
+        const int n = FFMIN(nb_samples - i, EVAL_BATCH);
 
+        for (k = 0; k < n; k++) {
+            ns[k] = eval->n + k;
+            ts[k] = ns[k] * (double)1/eval->sample_rate;
+        }
         for (j = 0; j < eval->nb_channels; j++) {
-            *((double *) samplesref->extended_data[j] + i) =
-                av_expr_eval(eval->expr[j], eval->var_values, NULL);
+            ret = av_expr_eval_array(eval->expr[j], (double *)samplesref->extended_data[j] + i,
+                                     n, eval->var_values, arrays, NULL);
+            if (ret < 0) {
+                av_frame_free(&samplesref);
+                return ret;
+            }
         }
+        eval->n += n;
     }
 
     samplesref->pts = eval->pts;
@@ -393,7 +409,7 @@ static int aeval_config_output(AVFilterLink *outlink)
     AVFilterContext *ctx = outlink->src;
     EvalContext *eval = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
-    int ret;
+    int i, ret;
 
     if (eval->same_chlayout) {
         eval->chlayout = inlink->channel_layout;
@@ -413,6 +429,18 @@ static int aeval_config_output(AVFilterLink *outlink)
     if (!eval->channel_values)
         return AVERROR(ENOMEM);
 
+    eval->channel_uses_val = av_realloc_f(eval->channel_uses_val,
+                                          eval->nb_channels, sizeof(*eval->channel_uses_val));
+    if (!eval->channel_uses_val)
+        return AVERROR(ENOMEM);
+    eval->uses_val = 0;
+    for (i = 0; i < eval->nb_channels; i++) {
+        unsigned count = 0;
+        av_expr_count_func(eval->expr[i], &count, 1, 1);
+        eval->channel_uses_val[i] = count > 0;
+        eval->uses_val |= count > 0;
+    }
+
     return 0;
 }
 
@@ -424,8 +452,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFilterLink *outlink = inlink->dst->outputs[0];
     int nb_samples        = in->nb_samples;
     AVFrame *out;
+    double ns[EVAL_BATCH], ts[EVAL_BATCH];
+    const double *arrays[VAR_VARS_NB] = { [VAR_N] = ns, [VAR_T] = ts };
     double t0;
-    int i, j;
+    int i, j, k, ret;
 
     out = ff_get_audio_buffer(outlink, nb_samples);
     if (!out) {
@@ -437,18 +467,44 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     t0 = TS2T(in->pts, inlink->time_base);
 
     /* evaluate expression for each single sample and for each channel */
-    for (i = 0; i < nb_samples; i++, eval->n++) {
-        eval->var_values[VAR_N] = eval->n;
-        eval->var_values[VAR_T] = t0 + i * (double)1/inlink->sample_rate;
-
-        for (j = 0; j < inlink->channels; j++)
-            eval->channel_values[j] = *((double *) in->extended_data[j] + i);
+    for (i = 0; i < nb_samples; i += EVAL_BATCH) {
+        const int n = FFMIN(nb_samples - i, EVAL_BATCH);
 
+        for (k = 0; k < n; k++) {
+            ns[k] = eval->n + k;
+            ts[k] = t0 + (i + k) * (double)1/inlink->sample_rate;
+        }
         for (j = 0; j < outlink->channels; j++) {
+            if (eval->channel_uses_val[j])
+                continue;
             eval->var_values[VAR_CH] = j;
-            *((double *) out->extended_data[j] + i) =
-                av_expr_eval(eval->expr[j], eval->var_values, eval);
+            ret = av_expr_eval_array(eval->expr[j], (double *)out->extended_data[j] + i,
+                                     n, eval->var_values, arrays, eval);
+            if (ret < 0) {
+                av_frame_free(&in);
+                av_frame_free(&out);
+                return ret;
+            }
+        }
+
+        /* val() returns the input of the current sample, so the expressions
+         * calling it are evaluated one sample at a time */
+        for (k = 0; k < n && eval->uses_val; k++) {
+            eval->var_values[VAR_N] = ns[k];
+            eval->var_values[VAR_T] = ts[k];
+
+            for (j = 0; j < inlink->channels; j++)
+                eval->channel_values[j] = *((double *) in->extended_data[j] + i + k);
+
+            for (j = 0; j < outlink->channels; j++) {
+                if (!eval->channel_uses_val[j])
+                    continue;
+                eval->var_values[VAR_CH] = j;
+                *((double *) out->extended_data[j] + i + k) =
+                    av_expr_eval(eval->expr[j], eval->var_values, eval);
+            }
         }
+        eval->n += n;
     }
 
     av_frame_free(&in);
@@ -22,6 +22,7 @@
 #define AVFILTER_MOTION_ESTIMATION_H
 
 #include "libavutil/avutil.h"
+#include "libavutil/pixelutils.h"
 
 #define AV_ME_METHOD_ESA        1
 #define AV_ME_METHOD_TSS        2
@@ -59,8 +60,23 @@ typedef struct AVMotionEstContext {
 
     uint64_t (*get_cost)(struct AVMotionEstContext *me_ctx, int x_mb, int y_mb,
                          int mv_x, int mv_y);
+
+    av_pixelutils_sad_fn sad[6];    ///< SAD of 2^n x 2^n blocks, indexed by n
 } AVMotionEstContext;
 
+/**
+ * Get the SAD function for size x size blocks.
+ *
+ * @return the function, or NULL if size is not a supported power of two
+ */
+static inline av_pixelutils_sad_fn ff_me_get_sad_fn(const AVMotionEstContext *me_ctx, int size)
+{
+    int n = av_log2(size);
+    if (n < 1 || n >= FF_ARRAY_ELEMS(me_ctx->sad) || size != 1 << n)
+        return NULL;
+    return me_ctx->sad[n];
+}
+
 void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_param,
                         int width, int height, int x_min, int x_max, int y_min, int y_max);
 
@@ -24,10 +24,21 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "libavutil/dict.h"
+
 typedef struct PSNRDSPContext {
     uint64_t (*sse_line)(const uint8_t *buf, const uint8_t *ref, int w);
 } PSNRDSPContext;
 
+void ff_psnr_init(PSNRDSPContext *dsp, int bpp);
 void ff_psnr_init_x86(PSNRDSPContext *dsp, int bpp);
 
+double ff_psnr_get(double mse, uint64_t nb_frames, int max);
+
+/**
+ * Set the entry key, followed by comp unless it is 0, of metadata to d
+ * printed with two decimals.
+ */
+void ff_psnr_set_meta(AVDictionary **metadata, const char *key, char comp, float d);
+
 #endif /* AVFILTER_PSNR_H */
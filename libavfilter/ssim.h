@@ -31,6 +31,32 @@ typedef struct SSIMDSPContext {
     float (*ssim_end_line)(const int (*sum0)[4], const int (*sum1)[4], int w);
 } SSIMDSPContext;
 
+void ff_ssim_init(SSIMDSPContext *dsp);
 void ff_ssim_init_x86(SSIMDSPContext *dsp);
 
+/**
+ * Compute the SSIM of the 8x8 windows of the lines of 4x4 blocks y_start to
+ * y_end - 1 of a plane, with 1 <= y_start <= y_end <= height / 4, and store
+ * the sum of each line y in line_ssim[y].
+ *
+ * @param temp scratch buffer of SSIM_TEMP_SIZE(width) bytes
+ * @param max  maximum sample value, samples are 16-bit when it is above 255
+ */
+void ff_ssim_plane(SSIMDSPContext *dsp,
+                   uint8_t *main, int main_stride,
+                   uint8_t *ref, int ref_stride,
+                   int width, int height, void *temp,
+                   int max, float *line_ssim, int y_start, int y_end);
+
+/**
+ * Return the SSIM of a plane from the line sums stored by ff_ssim_plane().
+ * The lines are added in order, so the result does not depend on how the
+ * plane was split between the calls.
+ */
+float ff_ssim_plane_end(const float *line_ssim, int width, int height);
+
+double ff_ssim_db(double ssim, double weight);
+
+#define SSIM_TEMP_SIZE(width) (2 * (((width) >> 2) + 3) * sizeof(int64_t[4]))
+
 #endif /* AVFILTER_SSIM_H */
@@ -0,0 +1,71 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavfilter/vf_tonemap.c"
+
+/* maximum absolute error of the interpolated curve, the output range is [0,1] */
+#define MAX_ERROR 1e-4
+
+#define SAMPLES 100000
+
+int main(void)
+{
+    static const struct {
+        const char *name;
+        enum TonemapAlgorithm tonemap;
+    } algos[] = {
+        { "gamma",  TONEMAP_GAMMA  },
+        { "mobius", TONEMAP_MOBIUS },
+    };
+    static const double peaks[] = { 1.5, 4.0, 10.0, 49.26, 100.0 };
+    int i, j, k, ret = 0;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(algos); i++) {
+        for (j = 0; j < FF_ARRAY_ELEMS(peaks); j++) {
+            TonemapContext s = { .tonemap = algos[i].tonemap, .param = NAN };
+            AVFilterContext ctx = { .priv = &s };
+            double peak = peaks[j], max_error = 0;
+            float hable_peak = hable(peak);
+
+            init(&ctx);
+            build_lut(&s, peak, hable_peak);
+
+            /* sample linearly up to and somewhat beyond the peak, and
+             * densely in the dark range */
+            for (k = 0; k <= 2 * SAMPLES; k++) {
+                float sig = k < SAMPLES ? 1.25 * peak * k / SAMPLES
+                                        : 1.25 * peak * pow((double)(k - SAMPLES) / SAMPLES, 4);
+                float exact, lut;
+
+                sig   = FFMAX(sig, 1e-6);
+                exact = tonemap_curve(&s, sig, peak, hable_peak);
+                lut   = lookup_curve(&s, sig, peak, hable_peak);
+                max_error = FFMAX(max_error, fabs(lut - exact));
+            }
+
+            printf("%-6s peak %6.2f: %s\n", algos[i].name, peak,
+                   max_error <= MAX_ERROR ? "OK" : "FAIL");
+            if (max_error > MAX_ERROR) {
+                fprintf(stderr, "max error %g\n", max_error);
+                ret = 1;
+            }
+        }
+    }
+
+    return ret;
+}
@@ -124,4 +124,20 @@ int avfilter_transform(const uint8_t *src, uint8_t *dst,
                         enum InterpolateMethod interpolate,
                         enum FillMethod fill);
 
+/**
+ * Do the affine transformation of avfilter_transform() for the lines
+ * slice_start to slice_end - 1 of the destination image only, so that
+ * separate slices can be computed concurrently.
+ *
+ * @param slice_start first line of the destination image to compute
+ * @param slice_end   line after the last one to compute
+ * @see avfilter_transform()
+ */
+int avfilter_transform_slice(const uint8_t *src, uint8_t *dst,
+                             int src_stride, int dst_stride,
+                             int width, int height, int slice_start, int slice_end,
+                             const float *matrix,
+                             enum InterpolateMethod interpolate,
+                             enum FillMethod fill);
+
 #endif /* AVFILTER_TRANSFORM_H */
@@ -78,32 +78,42 @@ static const AVOption decimate_options[] = {
 
 AVFILTER_DEFINE_CLASS(decimate);
 
-static void calc_diffs(const DecimateContext *dm, struct qitem *q,
-                       const AVFrame *f1, const AVFrame *f2)
+typedef struct ThreadData {
+    const AVFrame *f1, *f2;
+} ThreadData;
+
+static int calc_diffs_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int64_t maxdiff = -1;
+    const DecimateContext *dm = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *f1 = td->f1, *f2 = td->f2;
+    const int yblock_start = (dm->nyblocks *  jobnr   ) / nb_jobs;
+    const int yblock_end   = (dm->nyblocks * (jobnr+1)) / nb_jobs;
     int64_t *bdiffs = dm->bdiffs;
-    int plane, i, j;
-
-    memset(bdiffs, 0, dm->bdiffsize * sizeof(*bdiffs));
+    int plane;
 
     for (plane = 0; plane < (dm->chroma && f1->data[2] ? 3 : 1); plane++) {
         int x, y, xl;
         const int linesize1 = f1->linesize[plane];
         const int linesize2 = f2->linesize[plane];
-        const uint8_t *f1p = f1->data[plane];
-        const uint8_t *f2p = f2->data[plane];
         int width    = plane ? AV_CEIL_RSHIFT(f1->width,  dm->hsub) : f1->width;
         int height   = plane ? AV_CEIL_RSHIFT(f1->height, dm->vsub) : f1->height;
         int hblockx  = dm->blockx / 2;
         int hblocky  = dm->blocky / 2;
+        const uint8_t *f1p, *f2p;
+        int y_start, y_end;
 
         if (plane) {
             hblockx >>= dm->hsub;
             hblocky >>= dm->vsub;
         }
 
-        for (y = 0; y < height; y++) {
+        y_start = FFMIN(yblock_start * hblocky, height);
+        y_end   = FFMIN(yblock_end   * hblocky, height);
+        f1p = f1->data[plane] + y_start * linesize1;
+        f2p = f2->data[plane] + y_start * linesize2;
+
+        for (y = y_start; y < y_end; y++) {
             int ydest = y / hblocky;
             int xdest = 0;
 
@@ -125,6 +135,24 @@ static void calc_diffs(const DecimateContext *dm, struct qitem *q,
             f2p += linesize2;
         }
     }
+    return 0;
+}
+
+static void calc_diffs(AVFilterContext *ctx, struct qitem *q,
+                       const AVFrame *f1, const AVFrame *f2)
+{
+    const DecimateContext *dm = ctx->priv;
+    ThreadData td = { .f1 = f1, .f2 = f2 };
+    int64_t maxdiff = -1;
+    int64_t *bdiffs = dm->bdiffs;
+    int i, j;
+
+    memset(bdiffs, 0, dm->bdiffsize * sizeof(*bdiffs));
+
+    /* each job owns whole rows of blocks, so the sums do not depend on the
+     * number of jobs */
+    ctx->internal->execute(ctx, calc_diffs_slice, &td, NULL,
+                           FFMIN(dm->nyblocks, ff_filter_get_nb_threads(ctx)));
 
     for (i = 0; i < dm->nyblocks - 1; i++) {
         for (j = 0; j < dm->nxblocks - 1; j++) {
@@ -174,7 +202,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             dm->queue[dm->fid].maxbdiff = INT64_MAX;
             dm->queue[dm->fid].totdiff  = INT64_MAX;
         } else {
-            calc_diffs(dm, &dm->queue[dm->fid], prv, in);
+            calc_diffs(ctx, &dm->queue[dm->fid], prv, in);
         }
         if (++dm->fid != dm->cycle)
             return 0;
@@ -413,5 +441,5 @@ AVFilter ff_vf_decimate = {
     .query_formats = query_formats,
     .outputs       = decimate_outputs,
     .priv_class    = &decimate_class,
-    .flags         = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -178,6 +178,14 @@ typedef struct DrawTextContext {
     FT_Face face;                   ///< freetype font face handle
     FT_Stroker stroker;             ///< freetype stroker handle
     struct AVTreeNode *glyphs;      ///< rendered glyphs, stored using the UTF-32 char code
+    uint8_t *mask_buf;              ///< storage for text_mask and border_mask
+    unsigned int mask_buf_size;     ///< allocated size of mask_buf
+    uint8_t *text_mask;             ///< whole text layout rendered as an 8-bit alpha mask
+    uint8_t *border_mask;           ///< text border rendered as an 8-bit alpha mask
+    int mask_x, mask_y;             ///< position of the masks relative to the text position
+    int mask_w, mask_h;             ///< dimensions of the masks, also their line stride
+    char *mask_text;                ///< text the masks were rendered for
+    unsigned int mask_fontsize;     ///< font size the masks were rendered for
     char *x_expr;                   ///< expression for x position
     char *y_expr;                   ///< expression for y position
     AVExpr *x_pexpr, *y_pexpr;      ///< parsed expressions for x and y
@@ -807,6 +815,10 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->positions);
     s->nb_positions = 0;
 
+    av_freep(&s->mask_buf);
+    s->mask_buf_size = 0;
+    av_freep(&s->mask_text);
+
     av_tree_enumerate(s->glyphs, NULL, NULL, glyph_enu_free);
     av_tree_destroy(s->glyphs);
     s->glyphs = NULL;
@@ -1174,50 +1186,182 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height,
-                       FFDrawColor *color,
-                       int x, int y, int borderw)
+static void blend_glyph_mask(uint8_t *dst, int dst_linesize, const FT_Bitmap *bitmap)
+{
+    unsigned x, y;
+
+    for (y = 0; y < bitmap->rows; y++) {
+        const uint8_t *src = bitmap->buffer + y * bitmap->pitch;
+
+        for (x = 0; x < bitmap->width; x++) {
+            unsigned a = bitmap->pixel_mode == FT_PIXEL_MODE_MONO ?
+                         ((src[x >> 3] >> (~x & 7)) & 1) * 255 : src[x];
+            unsigned m = dst[x];
+
+            /* "over" composition of overlapping glyphs */
+            dst[x] = m + a - (m * a + 127) / 255;
+        }
+        dst += dst_linesize;
+    }
+}
+
+/**
+ * Render the glyphs of the expanded text at their positions into a single
+ * alpha mask, and their borders into a second one, so that a text layout is
+ * blended onto the frame in one pass per layer. The masks are kept as long
+ * as the text and the font size do not change.
+ */
+static int render_text_masks(AVFilterContext *ctx)
 {
+    DrawTextContext *s = ctx->priv;
     char *text = s->expanded_text.str;
+    const int borderw = s->borderw;
+    int x_min = INT_MAX, y_min = INT_MAX;
+    int x_max = INT_MIN, y_max = INT_MIN;
     uint32_t code = 0;
-    int i, x1, y1;
+    size_t size;
+    Glyph *glyph;
     uint8_t *p;
-    Glyph *glyph = NULL;
+    int i;
+
+    if (s->mask_text && !strcmp(s->mask_text, text) &&
+        s->mask_fontsize == s->fontsize)
+        return 0;
+    av_freep(&s->mask_text);
 
     for (i = 0, p = text; *p; i++) {
-        FT_Bitmap bitmap;
         Glyph dummy = { 0 };
         GET_UTF8(code, *p++, continue;);
 
         /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
+        if (is_newline(code) || code == '\t')
             continue;
 
         dummy.code = code;
         dummy.fontsize = s->fontsize;
         glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
 
-        bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
-
         if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
             glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
             return AVERROR(EINVAL);
 
-        x1 = s->positions[i].x+s->x+x - borderw;
-        y1 = s->positions[i].y+s->y+y - borderw;
+        x_min = FFMIN(x_min, s->positions[i].x - borderw);
+        y_min = FFMIN(y_min, s->positions[i].y - borderw);
+        x_max = FFMAX3(x_max, s->positions[i].x + (int)glyph->bitmap.width,
+                       s->positions[i].x - borderw + (int)glyph->border_bitmap.width);
+        y_max = FFMAX3(y_max, s->positions[i].y + (int)glyph->bitmap.rows,
+                       s->positions[i].y - borderw + (int)glyph->border_bitmap.rows);
+    }
 
-        ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
-                      bitmap.buffer, bitmap.pitch,
-                      bitmap.width, bitmap.rows,
-                      bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
-                      0, x1, y1);
+    if (x_min < x_max && y_min < y_max) {
+        s->mask_x = x_min;
+        s->mask_y = y_min;
+        s->mask_w = x_max - x_min;
+        s->mask_h = y_max - y_min;
+    } else {
+        s->mask_x = s->mask_y = s->mask_w = s->mask_h = 0;
     }
 
+    size = (size_t)s->mask_w * s->mask_h;
+    if (size > (INT_MAX - 1) / 2)
+        return AVERROR(EINVAL);
+    av_fast_malloc(&s->mask_buf, &s->mask_buf_size, FFMAX(2 * size, 1));
+    if (!s->mask_buf)
+        return AVERROR(ENOMEM);
+    s->text_mask   = s->mask_buf;
+    s->border_mask = s->mask_buf + size;
+    memset(s->mask_buf, 0, borderw ? 2 * size : size);
+
+    for (i = 0, p = text; *p; i++) {
+        Glyph dummy = { 0 };
+        GET_UTF8(code, *p++, continue;);
+
+        if (is_newline(code) || code == '\t')
+            continue;
+
+        dummy.code = code;
+        dummy.fontsize = s->fontsize;
+        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
+
+        blend_glyph_mask(s->text_mask + (s->positions[i].y - y_min) * s->mask_w +
+                                        s->positions[i].x - x_min,
+                         s->mask_w, &glyph->bitmap);
+        if (borderw)
+            blend_glyph_mask(s->border_mask + (s->positions[i].y - borderw - y_min) * s->mask_w +
+                                              s->positions[i].x - borderw - x_min,
+                             s->mask_w, &glyph->border_bitmap);
+    }
+
+    s->mask_text = av_strdup(text);
+    if (!s->mask_text)
+        return AVERROR(ENOMEM);
+    s->mask_fontsize = s->fontsize;
+
     return 0;
 }
 
+typedef struct ThreadData {
+    AVFrame *frame;
+    int width;
+    int y_start, y_end;
+    int box_w, box_h;
+    FFDrawColor fontcolor;
+    FFDrawColor shadowcolor;
+    FFDrawColor bordercolor;
+    FFDrawColor boxcolor;
+} ThreadData;
+
+static int draw_text_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int align = (1 << s->dc.vsub_max) - 1;
+    const int lines = td->y_end - td->y_start;
+    const int slice_start = td->y_start + (((lines * jobnr) / nb_jobs) & ~align);
+    const int slice_end   = jobnr == nb_jobs - 1 ? td->y_end :
+                            td->y_start + (((lines * (jobnr + 1)) / nb_jobs) & ~align);
+    const int h = slice_end - slice_start;
+    const int x = s->x + s->mask_x;
+    const int y = s->y + s->mask_y - slice_start;
+    uint8_t *dst[4] = { NULL };
+    int i;
+
+    if (h <= 0)
+        return 0;
+
+    /* slices start on chroma rows, so blending a slice gives the same
+     * result as blending the same rows of the whole frame */
+    for (i = 0; i < s->dc.nb_planes; i++)
+        dst[i] = td->frame->data[i] + (slice_start >> s->dc.vsub[i]) * td->frame->linesize[i];
+
+    if (s->draw_box)
+        ff_blend_rectangle(&s->dc, &td->boxcolor,
+                           dst, td->frame->linesize, td->width, h,
+                           s->x - s->boxborderw, s->y - s->boxborderw - slice_start,
+                           td->box_w + s->boxborderw * 2, td->box_h + s->boxborderw * 2);
+
+    if (!s->mask_w)
+        return 0;
+
+    if (s->shadowx || s->shadowy)
+        ff_blend_mask(&s->dc, &td->shadowcolor,
+                      dst, td->frame->linesize, td->width, h,
+                      s->text_mask, s->mask_w, s->mask_w, s->mask_h,
+                      3, 0, x + s->shadowx, y + s->shadowy);
+
+    if (s->borderw)
+        ff_blend_mask(&s->dc, &td->bordercolor,
+                      dst, td->frame->linesize, td->width, h,
+                      s->border_mask, s->mask_w, s->mask_w, s->mask_h,
+                      3, 0, x, y);
+
+    ff_blend_mask(&s->dc, &td->fontcolor,
+                  dst, td->frame->linesize, td->width, h,
+                  s->text_mask, s->mask_w, s->mask_w, s->mask_h,
+                  3, 0, x, y);
+
+    return 0;
+}
 
 static void update_color_with_alpha(DrawTextContext *s, FFDrawColor *color, const FFDrawColor incolor)
 {
@@ -1250,7 +1394,7 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     uint32_t code = 0, prev_code = 0;
     int x = 0, y = 0, i = 0, ret;
     int max_text_line_w = 0, len;
-    int box_w, box_h;
+    int box_w, box_h, nb_jobs;
     char *text;
     uint8_t *p;
     int y_min = 32000, y_max = -32000;
@@ -1263,10 +1407,7 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     struct tm ltime;
     AVBPrint *bp = &s->expanded_text;
 
-    FFDrawColor fontcolor;
-    FFDrawColor shadowcolor;
-    FFDrawColor bordercolor;
-    FFDrawColor boxcolor;
+    ThreadData td;
 
     av_bprint_clear(bp);
 
@@ -1386,6 +1527,9 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
 
     max_text_line_w = FFMAX(x, max_text_line_w);
 
+    if ((ret = render_text_masks(ctx)) < 0)
+        return ret;
+
     s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = max_text_line_w;
     s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = y + s->max_glyph_h;
 
@@ -1402,10 +1546,10 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     s->x = s->var_values[VAR_X] = av_expr_eval(s->x_pexpr, s->var_values, &s->prng);
 
     update_alpha(s);
-    update_color_with_alpha(s, &fontcolor  , s->fontcolor  );
-    update_color_with_alpha(s, &shadowcolor, s->shadowcolor);
-    update_color_with_alpha(s, &bordercolor, s->bordercolor);
-    update_color_with_alpha(s, &boxcolor   , s->boxcolor   );
+    update_color_with_alpha(s, &td.fontcolor  , s->fontcolor  );
+    update_color_with_alpha(s, &td.shadowcolor, s->shadowcolor);
+    update_color_with_alpha(s, &td.bordercolor, s->bordercolor);
+    update_color_with_alpha(s, &td.boxcolor   , s->boxcolor   );
 
     box_w = max_text_line_w;
     box_h = y + s->max_glyph_h;
@@ -1436,27 +1580,25 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
             s->y = FFMAX(height - box_h - offsetbottom, 0);
     }
 
-    /* draw box */
-    if (s->draw_box)
-        ff_blend_rectangle(&s->dc, &boxcolor,
-                           frame->data, frame->linesize, width, height,
-                           s->x - s->boxborderw, s->y - s->boxborderw,
-                           box_w + s->boxborderw * 2, box_h + s->boxborderw * 2);
-
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &shadowcolor, s->shadowx, s->shadowy, 0)) < 0)
-            return ret;
+    /* rows touched by the box, the shadow, the border and the text */
+    td.y_start = s->y + s->mask_y + FFMIN(s->shadowy, 0);
+    td.y_end   = s->y + s->mask_y + s->mask_h + FFMAX(s->shadowy, 0);
+    if (s->draw_box) {
+        td.y_start = FFMIN(td.y_start, s->y - s->boxborderw);
+        td.y_end   = FFMAX(td.y_end,   s->y + box_h + s->boxborderw);
     }
+    td.y_start = FFMAX(td.y_start, 0) & ~((1 << s->dc.vsub_max) - 1);
+    td.y_end   = FFMIN(td.y_end, height);
+    if (td.y_start >= td.y_end)
+        return 0;
 
-    if (s->borderw) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &bordercolor, 0, 0, s->borderw)) < 0)
-            return ret;
-    }
-    if ((ret = draw_glyphs(s, frame, width, height,
-                           &fontcolor, 0, 0, 0)) < 0)
-        return ret;
+    td.frame  = frame;
+    td.width  = width;
+    td.box_w  = box_w;
+    td.box_h  = box_h;
+    /* text areas are usually small, do not split them into tiny slices */
+    nb_jobs = av_clip((td.y_end - td.y_start) / 16, 1, ff_filter_get_nb_threads(ctx));
+    ctx->internal->execute(ctx, draw_text_slice, &td, NULL, nb_jobs);
 
     return 0;
 }
@@ -1529,5 +1671,5 @@ AVFilter ff_vf_drawtext = {
     .inputs        = avfilter_vf_drawtext_inputs,
     .outputs       = avfilter_vf_drawtext_outputs,
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -39,6 +39,7 @@
 #include "avfilter.h"
 #include "filters.h"
 #include "internal.h"
+#include "scene_sad.h"
 
 #define INPUT_MAIN     0
 #define INPUT_CLEANSRC 1
@@ -106,9 +107,14 @@ typedef struct FieldMatchContext {
     int map_linesize[4];
     uint8_t *cmask_data[4];
     int cmask_linesize[4];
-    int *c_array;
+    int *c_array;                   ///< block counters, one set per job
+    int c_array_size;               ///< number of counters in each set
     int tpitchy, tpitchuv;
     uint8_t *tbuffer;
+    uint64_t (*accum)[6];           ///< field comparison sums, one set per job
+
+    int nb_threads;
+    ff_scene_sad_fn sad;
 } FieldMatchContext;
 
 #define OFFSET(x) offsetof(FieldMatchContext, x)
@@ -163,23 +169,12 @@ static int get_height(const FieldMatchContext *fm, const AVFrame *f, int plane)
     return plane ? AV_CEIL_RSHIFT(f->height, fm->vsub) : f->height;
 }
 
-static int64_t luma_abs_diff(const AVFrame *f1, const AVFrame *f2)
+static int64_t luma_abs_diff(const FieldMatchContext *fm, const AVFrame *f1, const AVFrame *f2)
 {
-    int x, y;
-    const uint8_t *srcp1 = f1->data[0];
-    const uint8_t *srcp2 = f2->data[0];
-    const int src1_linesize = f1->linesize[0];
-    const int src2_linesize = f2->linesize[0];
-    const int width  = f1->width;
-    const int height = f1->height;
-    int64_t acc = 0;
+    uint64_t acc;
 
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++)
-            acc += abs(srcp1[x] - srcp2[x]);
-        srcp1 += src1_linesize;
-        srcp2 += src2_linesize;
-    }
+    fm->sad(f1->data[0], f1->linesize[0], f2->data[0], f2->linesize[0],
+            f1->width, f1->height, &acc);
     return acc;
 }
 
@@ -193,25 +188,36 @@ static void fill_buf(uint8_t *data, int w, int h, int linesize, uint8_t v)
     }
 }
 
-static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
+typedef struct CombThreadData {
+    const AVFrame *src;
+    int plane;
+} CombThreadData;
+
+static int comb_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y, plane, max_v = 0;
+    const FieldMatchContext *fm = ctx->priv;
+    const CombThreadData *td = arg;
+    const AVFrame *src = td->src;
+    const int plane = td->plane;
     const int cthresh = fm->cthresh;
     const int cthresh6 = cthresh * 6;
+    const int src_linesize = src->linesize[plane];
+    const int cmk_linesize = fm->cmask_linesize[plane];
+    const int width  = get_width (fm, src, plane);
+    const int height = get_height(fm, src, plane);
+    const int slice_start = (height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+    int x, y;
 
-    for (plane = 0; plane < (fm->chroma ? 3 : 1); plane++) {
-        const uint8_t *srcp = src->data[plane];
-        const int src_linesize = src->linesize[plane];
-        const int width  = get_width (fm, src, plane);
-        const int height = get_height(fm, src, plane);
-        uint8_t *cmkp = fm->cmask_data[plane];
-        const int cmk_linesize = fm->cmask_linesize[plane];
+    for (y = slice_start; y < slice_end; y++) {
+        const uint8_t *srcp = src->data[plane] + y * src_linesize;
+        uint8_t *cmkp = fm->cmask_data[plane] + y * cmk_linesize;
 
         if (cthresh < 0) {
-            fill_buf(cmkp, width, height, cmk_linesize, 0xff);
+            memset(cmkp, 0xff, width);
             continue;
         }
-        fill_buf(cmkp, width, height, cmk_linesize, 0);
+        memset(cmkp, 0, width);
 
         /* [1 -3 4 -3 1] vertical filter */
 #define FILTER(xm2, xm1, xp1, xp2) \
@@ -219,53 +225,170 @@ static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
              -3 * (srcp[x + (xm1)*src_linesize] + srcp[x + (xp1)*src_linesize]) \
              +    (srcp[x + (xm2)*src_linesize] + srcp[x + (xp2)*src_linesize])) > cthresh6
 
-        /* first line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && FILTER(2, 1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* second line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* all lines minus first two and last two */
-        for (y = 2; y < height-2; y++) {
+        if (y == 0) {
+            /* first line */
+            for (x = 0; x < width; x++) {
+                const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
+                if (s1 > cthresh && FILTER(2, 1, 1, 2))
+                    cmkp[x] = 0xff;
+            }
+        } else if (y == 1) {
+            /* second line */
+            for (x = 0; x < width; x++) {
+                const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
+                    cmkp[x] = 0xff;
+            }
+        } else if (y < height - 2) {
+            /* all lines minus first two and last two */
             for (x = 0; x < width; x++) {
                 const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
                 const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
                 if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, 2))
                     cmkp[x] = 0xff;
             }
-            srcp += src_linesize;
-            cmkp += cmk_linesize;
+        } else if (y == height - 2) {
+            /* before-last line */
+            for (x = 0; x < width; x++) {
+                const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
+                    cmkp[x] = 0xff;
+            }
+        } else {
+            /* last line */
+            for (x = 0; x < width; x++) {
+                const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                if (s1 > cthresh && FILTER(-2, -1, -1, -2))
+                    cmkp[x] = 0xff;
+            }
         }
+    }
+    return 0;
+}
+
+static int get_comb_steps(const FieldMatchContext *fm, const AVFrame *src, int *heighta)
+{
+    const int yhalf = fm->blocky / 2;
+
+    *heighta = (src->height / yhalf) * yhalf;
+    if (*heighta == src->height)
+        *heighta = src->height - yhalf;
+    return *heighta > 0 ? (*heighta - 1) / yhalf : 0;
+}
+
+/**
+ * Count the combed pixels of the luma mask in overlapping blocks. Each job
+ * accumulates its own block counters, which are summed afterwards.
+ */
+static int comb_count_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const CombThreadData *td = arg;
+    const AVFrame *src = td->src;
+    const int blockx = fm->blockx;
+    const int blocky = fm->blocky;
+    const int xhalf = blockx/2;
+    const int yhalf = blocky/2;
+    const int cmk_linesize = fm->cmask_linesize[0];
+    const uint8_t *cmkp;
+    const int width  = src->width;
+    const int height = src->height;
+    const int xblocks = ((width+xhalf)/blockx) + 1;
+    const int xblocks4 = xblocks<<2;
+    const int yblocks = ((height+yhalf)/blocky) + 1;
+    int *c_array = fm->c_array + jobnr * fm->c_array_size;
+    const int arraysize = (xblocks*yblocks)<<2;
+    const int widtha = (width /(blockx/2))*(blockx/2);
+    int heighta;
+    const int nb_steps   = get_comb_steps(fm, src, &heighta);
+    const int step_start = (nb_steps *  jobnr   ) / nb_jobs;
+    const int step_end   = (nb_steps * (jobnr+1)) / nb_jobs;
+    int x, y;
+
+    memset(c_array, 0, arraysize * sizeof(*c_array));
+
+#define C_ARRAY_ADD(v) do {                         \
+    const int box1 = (x / blockx) * 4;              \
+    const int box2 = ((x + xhalf) / blockx) * 4;    \
+    c_array[temp1 + box1    ] += v;                 \
+    c_array[temp1 + box2 + 1] += v;                 \
+    c_array[temp2 + box1 + 2] += v;                 \
+    c_array[temp2 + box2 + 3] += v;                 \
+} while (0)
 
-        /* before-last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
-                cmkp[x] = 0xff;
+#define VERTICAL_HALF(y_start, y_end) do {                                  \
+    for (y = y_start; y < y_end; y++) {                                     \
+        const int temp1 = (y / blocky) * xblocks4;                          \
+        const int temp2 = ((y + yhalf) / blocky) * xblocks4;                \
+        for (x = 0; x < width; x++)                                         \
+            if (cmkp[x - cmk_linesize] == 0xff &&                           \
+                cmkp[x               ] == 0xff &&                           \
+                cmkp[x + cmk_linesize] == 0xff)                             \
+                C_ARRAY_ADD(1);                                             \
+        cmkp += cmk_linesize;                                               \
+    }                                                                       \
+} while (0)
+
+    if (jobnr == 0) {
+        cmkp = fm->cmask_data[0] + cmk_linesize;
+        VERTICAL_HALF(1, yhalf);
+    }
+
+    cmkp = fm->cmask_data[0] + cmk_linesize * yhalf * (step_start + 1);
+    for (y = yhalf * (step_start + 1); y < yhalf * (step_end + 1); y += yhalf) {
+        const int temp1 = (y / blocky) * xblocks4;
+        const int temp2 = ((y + yhalf) / blocky) * xblocks4;
+
+        for (x = 0; x < widtha; x += xhalf) {
+            const uint8_t *cmkp_tmp = cmkp + x;
+            int u, v, sum = 0;
+            for (u = 0; u < yhalf; u++) {
+                for (v = 0; v < xhalf; v++)
+                    if (cmkp_tmp[v - cmk_linesize] == 0xff &&
+                        cmkp_tmp[v               ] == 0xff &&
+                        cmkp_tmp[v + cmk_linesize] == 0xff)
+                        sum++;
+                cmkp_tmp += cmk_linesize;
+            }
+            if (sum)
+                C_ARRAY_ADD(sum);
         }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            if (s1 > cthresh && FILTER(-2, -1, -1, -2))
-                cmkp[x] = 0xff;
+
+        for (x = widtha; x < width; x++) {
+            const uint8_t *cmkp_tmp = cmkp + x;
+            int u, sum = 0;
+            for (u = 0; u < yhalf; u++) {
+                if (cmkp_tmp[-cmk_linesize] == 0xff &&
+                    cmkp_tmp[            0] == 0xff &&
+                    cmkp_tmp[ cmk_linesize] == 0xff)
+                    sum++;
+                cmkp_tmp += cmk_linesize;
+            }
+            if (sum)
+                C_ARRAY_ADD(sum);
         }
+
+        cmkp += cmk_linesize * yhalf;
+    }
+
+    if (jobnr == nb_jobs - 1)
+        VERTICAL_HALF(heighta, height - 1);
+
+    return 0;
+}
+
+static int calc_combed_score(AVFilterContext *ctx, const AVFrame *src)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    CombThreadData td = { .src = src };
+    int x, y, j, plane, nb_jobs, heighta, max_v = 0;
+
+    for (plane = 0; plane < (fm->chroma ? 3 : 1); plane++) {
+        td.plane = plane;
+        nb_jobs = FFMIN(get_height(fm, src, plane), fm->nb_threads);
+        ctx->internal->execute(ctx, comb_mask_slice, &td, NULL, nb_jobs);
     }
 
     if (fm->chroma) {
@@ -301,91 +424,21 @@ static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
         }
     }
 
+    nb_jobs = av_clip(get_comb_steps(fm, src, &heighta), 1, fm->nb_threads);
+    ctx->internal->execute(ctx, comb_count_slice, &td, NULL, nb_jobs);
+
     {
-        const int blockx = fm->blockx;
-        const int blocky = fm->blocky;
-        const int xhalf = blockx/2;
-        const int yhalf = blocky/2;
-        const int cmk_linesize = fm->cmask_linesize[0];
-        const uint8_t *cmkp    = fm->cmask_data[0] + cmk_linesize;
-        const int width  = src->width;
-        const int height = src->height;
-        const int xblocks = ((width+xhalf)/blockx) + 1;
-        const int xblocks4 = xblocks<<2;
-        const int yblocks = ((height+yhalf)/blocky) + 1;
-        int *c_array = fm->c_array;
+        const int xblocks = ((src->width  + fm->blockx/2) / fm->blockx) + 1;
+        const int yblocks = ((src->height + fm->blocky/2) / fm->blocky) + 1;
         const int arraysize = (xblocks*yblocks)<<2;
-        int      heighta = (height/(blocky/2))*(blocky/2);
-        const int widtha = (width /(blockx/2))*(blockx/2);
-        if (heighta == height)
-            heighta = height - yhalf;
-        memset(c_array, 0, arraysize * sizeof(*c_array));
-
-#define C_ARRAY_ADD(v) do {                         \
-    const int box1 = (x / blockx) * 4;              \
-    const int box2 = ((x + xhalf) / blockx) * 4;    \
-    c_array[temp1 + box1    ] += v;                 \
-    c_array[temp1 + box2 + 1] += v;                 \
-    c_array[temp2 + box1 + 2] += v;                 \
-    c_array[temp2 + box2 + 3] += v;                 \
-} while (0)
 
-#define VERTICAL_HALF(y_start, y_end) do {                                  \
-    for (y = y_start; y < y_end; y++) {                                     \
-        const int temp1 = (y / blocky) * xblocks4;                          \
-        const int temp2 = ((y + yhalf) / blocky) * xblocks4;                \
-        for (x = 0; x < width; x++)                                         \
-            if (cmkp[x - cmk_linesize] == 0xff &&                           \
-                cmkp[x               ] == 0xff &&                           \
-                cmkp[x + cmk_linesize] == 0xff)                             \
-                C_ARRAY_ADD(1);                                             \
-        cmkp += cmk_linesize;                                               \
-    }                                                                       \
-} while (0)
-
-        VERTICAL_HALF(1, yhalf);
-
-        for (y = yhalf; y < heighta; y += yhalf) {
-            const int temp1 = (y / blocky) * xblocks4;
-            const int temp2 = ((y + yhalf) / blocky) * xblocks4;
-
-            for (x = 0; x < widtha; x += xhalf) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, v, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    for (v = 0; v < xhalf; v++)
-                        if (cmkp_tmp[v - cmk_linesize] == 0xff &&
-                            cmkp_tmp[v               ] == 0xff &&
-                            cmkp_tmp[v + cmk_linesize] == 0xff)
-                            sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
-            }
-
-            for (x = widtha; x < width; x++) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    if (cmkp_tmp[-cmk_linesize] == 0xff &&
-                        cmkp_tmp[            0] == 0xff &&
-                        cmkp_tmp[ cmk_linesize] == 0xff)
-                        sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
-            }
-
-            cmkp += cmk_linesize * yhalf;
+        for (x = 0; x < arraysize; x++) {
+            int v = fm->c_array[x];
+            for (j = 1; j < nb_jobs; j++)
+                v += fm->c_array[j * fm->c_array_size + x];
+            if (v > max_v)
+                max_v = v;
         }
-
-        VERTICAL_HALF(heighta, height - 1);
-
-        for (x = 0; x < arraysize; x++)
-            if (c_array[x] > max_v)
-                max_v = c_array[x];
     }
     return max_v;
 }
@@ -410,63 +463,51 @@ static void build_abs_diff_mask(const uint8_t *prvp, int prv_linesize,
 }
 
 /**
- * Build a map over which pixels differ a lot/a little
+ * Build one line of the map over which pixels differ a lot/a little
  */
-static void build_diff_map(FieldMatchContext *fm,
-                           const uint8_t *prvp, int prv_linesize,
-                           const uint8_t *nxtp, int nxt_linesize,
-                           uint8_t *dstp, int dst_linesize, int height,
-                           int width, int plane)
+static void build_diff_map_line(const uint8_t *dp, int tpitch, uint8_t *dstp,
+                                int y, int height, int width)
 {
-    int x, y, u, diff, count;
-    int tpitch = plane ? fm->tpitchuv : fm->tpitchy;
-    const uint8_t *dp = fm->tbuffer + tpitch;
-
-    build_abs_diff_mask(prvp, prv_linesize, nxtp, nxt_linesize,
-                        fm->tbuffer, tpitch, width, height>>1);
-
-    for (y = 2; y < height - 2; y += 2) {
-        for (x = 1; x < width - 1; x++) {
-            diff = dp[x];
-            if (diff > 3) {
-                for (count = 0, u = x-1; u < x+2 && count < 2; u++) {
-                    count += dp[u-tpitch] > 3;
-                    count += dp[u       ] > 3;
-                    count += dp[u+tpitch] > 3;
-                }
-                if (count > 1) {
-                    dstp[x] = 1;
-                    if (diff > 19) {
-                        int upper = 0, lower = 0;
-                        for (count = 0, u = x-1; u < x+2 && count < 6; u++) {
-                            if (dp[u-tpitch] > 19) { count++; upper = 1; }
-                            if (dp[u       ] > 19)   count++;
-                            if (dp[u+tpitch] > 19) { count++; lower = 1; }
-                        }
-                        if (count > 3) {
-                            if (upper && lower) {
-                                dstp[x] |= 1<<1;
-                            } else {
-                                int upper2 = 0, lower2 = 0;
-                                for (u = FFMAX(x-4,0); u < FFMIN(x+5,width); u++) {
-                                    if (y != 2 &&        dp[u-2*tpitch] > 19) upper2 = 1;
-                                    if (                 dp[u-  tpitch] > 19) upper  = 1;
-                                    if (                 dp[u+  tpitch] > 19) lower  = 1;
-                                    if (y != height-4 && dp[u+2*tpitch] > 19) lower2 = 1;
-                                }
-                                if ((upper && (lower || upper2)) ||
-                                    (lower && (upper || lower2)))
-                                    dstp[x] |= 1<<1;
-                                else if (count > 5)
-                                    dstp[x] |= 1<<2;
+    int x, u, diff, count;
+
+    for (x = 1; x < width - 1; x++) {
+        diff = dp[x];
+        if (diff > 3) {
+            for (count = 0, u = x-1; u < x+2 && count < 2; u++) {
+                count += dp[u-tpitch] > 3;
+                count += dp[u       ] > 3;
+                count += dp[u+tpitch] > 3;
+            }
+            if (count > 1) {
+                dstp[x] = 1;
+                if (diff > 19) {
+                    int upper = 0, lower = 0;
+                    for (count = 0, u = x-1; u < x+2 && count < 6; u++) {
+                        if (dp[u-tpitch] > 19) { count++; upper = 1; }
+                        if (dp[u       ] > 19)   count++;
+                        if (dp[u+tpitch] > 19) { count++; lower = 1; }
+                    }
+                    if (count > 3) {
+                        if (upper && lower) {
+                            dstp[x] |= 1<<1;
+                        } else {
+                            int upper2 = 0, lower2 = 0;
+                            for (u = FFMAX(x-4,0); u < FFMIN(x+5,width); u++) {
+                                if (y != 2 &&        dp[u-2*tpitch] > 19) upper2 = 1;
+                                if (                 dp[u-  tpitch] > 19) upper  = 1;
+                                if (                 dp[u+  tpitch] > 19) lower  = 1;
+                                if (y != height-4 && dp[u+2*tpitch] > 19) lower2 = 1;
                             }
+                            if ((upper && (lower || upper2)) ||
+                                (lower && (upper || lower2)))
+                                dstp[x] |= 1<<1;
+                            else if (count > 5)
+                                dstp[x] |= 1<<2;
                         }
                     }
                 }
             }
         }
-        dp += tpitch;
-        dstp += dst_linesize;
     }
 }
 
@@ -484,20 +525,137 @@ static AVFrame *select_frame(FieldMatchContext *fm, int match)
     else  /* match == mC */              return fm->src;
 }
 
-static int compare_fields(FieldMatchContext *fm, int match1, int match2, int field)
+typedef struct CompareThreadData {
+    const uint8_t *prvp, *nxtp;         ///< fields the difference map is built from
+    int prv_linesize, nxt_linesize;
+    uint8_t *map;                       ///< start of the plane map
+    int map_linesize;                   ///< frame stride of the plane map
+    const uint8_t *mapp;                ///< first map line of the compared field pair
+    uint8_t *dstp;                      ///< first map line written by the difference map
+    const uint8_t *srcpf, *srcf, *srcnf;
+    const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
+    int srcf_linesize, prvf_linesize, nxtf_linesize;
+    int tpitch;
+    int width, height;
+    int startx, stopx;
+    int y0a, y1a;
+} CompareThreadData;
+
+/* number of field lines the comparison runs over: y = 2, 4, ... < height - 2 */
+static int get_compare_lines(int height)
+{
+    return height > 4 ? (height - 3) / 2 : 0;
+}
+
+static int diff_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const CompareThreadData *td = arg;
+    const int lines = td->height >> 1;
+    const int map_start   = (td->height *  jobnr   ) / nb_jobs;
+    const int map_end     = (td->height * (jobnr+1)) / nb_jobs;
+    const int slice_start = (lines *  jobnr   ) / nb_jobs;
+    const int slice_end   = (lines * (jobnr+1)) / nb_jobs;
+
+    fill_buf(td->map + map_start * td->map_linesize, td->width,
+             map_end - map_start, td->map_linesize, 0);
+    build_abs_diff_mask(td->prvp + slice_start * td->prv_linesize, td->prv_linesize,
+                        td->nxtp + slice_start * td->nxt_linesize, td->nxt_linesize,
+                        fm->tbuffer + slice_start * td->tpitch, td->tpitch,
+                        td->width, slice_end - slice_start);
+    return 0;
+}
+
+static int diff_map_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const CompareThreadData *td = arg;
+    const int map_linesize = td->map_linesize << 1;
+    const int lines = get_compare_lines(td->height);
+    const int slice_start = (lines *  jobnr   ) / nb_jobs;
+    const int slice_end   = (lines * (jobnr+1)) / nb_jobs;
+    int n;
+
+    for (n = slice_start; n < slice_end; n++)
+        build_diff_map_line(fm->tbuffer + (n + 1) * td->tpitch, td->tpitch,
+                            td->dstp + n * map_linesize, 2 + 2 * n,
+                            td->height, td->width);
+    return 0;
+}
+
+static int compare_fields_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const CompareThreadData *td = arg;
+    const int map_linesize = td->map_linesize << 1;
+    const int lines = get_compare_lines(td->height);
+    const int slice_start = (lines *  jobnr   ) / nb_jobs;
+    const int slice_end   = (lines * (jobnr+1)) / nb_jobs;
+    const int y0a = td->y0a, y1a = td->y1a;
+    uint64_t *accum = fm->accum[jobnr];
+    int x, n, temp1, temp2;
+
+    for (n = slice_start; n < slice_end; n++) {
+        const int y = 2 + 2 * n;
+        const uint8_t *mapp  = td->mapp  + n * map_linesize;
+        const uint8_t *srcpf = td->srcpf + n * td->srcf_linesize;
+        const uint8_t *srcf  = td->srcf  + n * td->srcf_linesize;
+        const uint8_t *srcnf = td->srcnf + n * td->srcf_linesize;
+        const uint8_t *prvpf = td->prvpf + n * td->prvf_linesize;
+        const uint8_t *prvnf = td->prvnf + n * td->prvf_linesize;
+        const uint8_t *nxtpf = td->nxtpf + n * td->nxtf_linesize;
+        const uint8_t *nxtnf = td->nxtnf + n * td->nxtf_linesize;
+
+        if (y0a != y1a && y >= y0a && y <= y1a)
+            continue;
+
+        for (x = td->startx; x < td->stopx; x++) {
+            if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
+                temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
+
+                temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
+                if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
+                    accum[0] += temp2;
+                if (temp2 > 42) {
+                    if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
+                        accum[1] += temp2;
+                    if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
+                        accum[2] += temp2;
+                }
+
+                temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
+                if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
+                    accum[3] += temp2;
+                if (temp2 > 42) {
+                    if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
+                        accum[4] += temp2;
+                    if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
+                        accum[5] += temp2;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static int compare_fields(AVFilterContext *ctx, int match1, int match2, int field)
 {
-    int plane, ret;
+    FieldMatchContext *fm = ctx->priv;
+    int i, plane, ret;
     uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
     uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
     int norm1, norm2, mtn1, mtn2;
     float c1, c2, mr;
     const AVFrame *src = fm->src;
 
+    memset(fm->accum, 0, fm->nb_threads * sizeof(*fm->accum));
+
     for (plane = 0; plane < (fm->mchroma ? 3 : 1); plane++) {
-        int x, y, temp1, temp2, fbase;
+        CompareThreadData td;
+        int fbase, nb_jobs;
         const AVFrame *prev, *next;
         uint8_t *mapp    = fm->map_data[plane];
-        int map_linesize = fm->map_linesize[plane];
+        const int map_linesize = fm->map_linesize[plane];
         const uint8_t *srcp = src->data[plane];
         const int src_linesize  = src->linesize[plane];
         const int srcf_linesize = src_linesize << 1;
@@ -505,20 +663,12 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         int prvf_linesize, nxtf_linesize;
         const int width  = get_width (fm, src, plane);
         const int height = get_height(fm, src, plane);
-        const int y0a = fm->y0 >> (plane ? fm->vsub : 0);
-        const int y1a = fm->y1 >> (plane ? fm->vsub : 0);
-        const int startx = (plane == 0 ? 8 : 8 >> fm->hsub);
-        const int stopx  = width - startx;
-        const uint8_t *srcpf, *srcf, *srcnf;
+        const uint8_t *srcf;
         const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
 
-        fill_buf(mapp, width, height, map_linesize, 0);
-
         /* match1 */
         fbase = get_field_base(match1, field);
         srcf  = srcp + (fbase + 1) * src_linesize;
-        srcpf = srcf - srcf_linesize;
-        srcnf = srcf + srcf_linesize;
         mapp  = mapp + fbase * map_linesize;
         prev = select_frame(fm, match1);
         prv_linesize  = prev->linesize[plane];
@@ -534,51 +684,54 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         nxtpf = next->data[plane] + fbase * nxt_linesize;   // next frame, previous field
         nxtnf = nxtpf + nxtf_linesize;                      // next frame, next     field
 
-        map_linesize <<= 1;
-        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1))
-            build_diff_map(fm, prvpf, prvf_linesize, nxtpf, nxtf_linesize,
-                           mapp, map_linesize, height, width, plane);
-        else
-            build_diff_map(fm, prvnf, prvf_linesize, nxtnf, nxtf_linesize,
-                           mapp + map_linesize, map_linesize, height, width, plane);
-
-        for (y = 2; y < height - 2; y += 2) {
-            if (y0a == y1a || y < y0a || y > y1a) {
-                for (x = startx; x < stopx; x++) {
-                    if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
-                        temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
-
-                        temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumPc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumPm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumPml += temp2;
-                        }
-
-                        temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumNc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumNm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumNml += temp2;
-                        }
-                    }
-                }
-            }
-            prvpf += prvf_linesize;
-            prvnf += prvf_linesize;
-            srcpf += srcf_linesize;
-            srcf  += srcf_linesize;
-            srcnf += srcf_linesize;
-            nxtpf += nxtf_linesize;
-            nxtnf += nxtf_linesize;
-            mapp  += map_linesize;
+        td = (CompareThreadData) {
+            .map           = fm->map_data[plane],
+            .map_linesize  = map_linesize,
+            .mapp          = mapp,
+            .srcpf         = srcf - srcf_linesize,
+            .srcf          = srcf,
+            .srcnf         = srcf + srcf_linesize,
+            .prvpf         = prvpf,
+            .prvnf         = prvnf,
+            .nxtpf         = nxtpf,
+            .nxtnf         = nxtnf,
+            .srcf_linesize = srcf_linesize,
+            .prvf_linesize = prvf_linesize,
+            .nxtf_linesize = nxtf_linesize,
+            .prv_linesize  = prvf_linesize,
+            .nxt_linesize  = nxtf_linesize,
+            .tpitch        = plane ? fm->tpitchuv : fm->tpitchy,
+            .width         = width,
+            .height        = height,
+            .startx        = plane == 0 ? 8 : 8 >> fm->hsub,
+            .stopx         = width - (plane == 0 ? 8 : 8 >> fm->hsub),
+            .y0a           = fm->y0 >> (plane ? fm->vsub : 0),
+            .y1a           = fm->y1 >> (plane ? fm->vsub : 0),
+        };
+        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1)) {
+            td.prvp = prvpf;
+            td.nxtp = nxtpf;
+            td.dstp = mapp;
+        } else {
+            td.prvp = prvnf;
+            td.nxtp = nxtnf;
+            td.dstp = mapp + (map_linesize << 1);
         }
+
+        /* each pass reads lines written by neighbouring jobs of the previous one */
+        nb_jobs = av_clip(get_compare_lines(height), 1, fm->nb_threads);
+        ctx->internal->execute(ctx, diff_mask_slice,      &td, NULL, nb_jobs);
+        ctx->internal->execute(ctx, diff_map_slice,       &td, NULL, nb_jobs);
+        ctx->internal->execute(ctx, compare_fields_slice, &td, NULL, nb_jobs);
+    }
+
+    for (i = 0; i < fm->nb_threads; i++) {
+        accumPc  += fm->accum[i][0];
+        accumPm  += fm->accum[i][1];
+        accumPml += fm->accum[i][2];
+        accumNc  += fm->accum[i][3];
+        accumNm  += fm->accum[i][4];
+        accumNml += fm->accum[i][5];
     }
 
     if (accumPm < 500 && accumNm < 500 && (accumPml >= 500 || accumNml >= 500) &&
@@ -656,7 +809,7 @@ static int checkmm(AVFilterContext *ctx, int *combs, int m1, int m2,
         if (!gen_frames[mid])                                                   \
             gen_frames[mid] = create_weave_frame(ctx, mid, field,               \
                                                  fm->prv, fm->src, fm->nxt);    \
-        combs[mid] = calc_combed_score(fm, gen_frames[mid]);                    \
+        combs[mid] = calc_combed_score(ctx, gen_frames[mid]);                   \
     }                                                                           \
 } while (0)
 
@@ -727,7 +880,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             gen_frames[i] = create_weave_frame(ctx, i, field, fm->prv, fm->src, fm->nxt);
             if (!gen_frames[i])
                 return AVERROR(ENOMEM);
-            combs[i] = calc_combed_score(fm, gen_frames[i]);
+            combs[i] = calc_combed_score(ctx, gen_frames[i]);
         }
         av_log(ctx, AV_LOG_INFO, "COMBS: %3d %3d %3d %3d %3d\n",
                combs[0], combs[1], combs[2], combs[3], combs[4]);
@@ -738,22 +891,22 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
 
     /* p/c selection and optional 3-way p/c/n matches */
-    match = compare_fields(fm, fxo[mC], fxo[mP], field);
+    match = compare_fields(ctx, fxo[mC], fxo[mP], field);
     if (fm->mode == MODE_PCN || fm->mode == MODE_PCN_UB)
-        match = compare_fields(fm, match, fxo[mN], field);
+        match = compare_fields(ctx, match, fxo[mN], field);
 
     /* scene change check */
     if (fm->combmatch == COMBMATCH_SC) {
         if (fm->lastn == outlink->frame_count_in - 1) {
             if (fm->lastscdiff > fm->scthresh)
                 sc = 1;
-        } else if (luma_abs_diff(fm->prv, fm->src) > fm->scthresh) {
+        } else if (luma_abs_diff(fm, fm->prv, fm->src) > fm->scthresh) {
             sc = 1;
         }
 
         if (!sc) {
             fm->lastn = outlink->frame_count_in;
-            fm->lastscdiff = luma_abs_diff(fm->src, fm->nxt);
+            fm->lastscdiff = luma_abs_diff(fm, fm->src, fm->nxt);
             sc = fm->lastscdiff > fm->scthresh;
         }
     }
@@ -938,11 +1091,18 @@ static int config_input(AVFilterLink *inlink)
     fm->tpitchy  = FFALIGN(w,      16);
     fm->tpitchuv = FFALIGN(w >> 1, 16);
 
+    fm->nb_threads = ff_filter_get_nb_threads(ctx);
+    fm->sad = ff_scene_sad_get_fn(8);
+    if (!fm->sad)
+        return AVERROR(EINVAL);
+
     fm->tbuffer = av_malloc(h/2 * fm->tpitchy);
-    fm->c_array = av_malloc((((w + fm->blockx/2)/fm->blockx)+1) *
-                            (((h + fm->blocky/2)/fm->blocky)+1) *
-                            4 * sizeof(*fm->c_array));
-    if (!fm->tbuffer || !fm->c_array)
+    fm->c_array_size = (((w + fm->blockx/2)/fm->blockx)+1) *
+                       (((h + fm->blocky/2)/fm->blocky)+1) * 4;
+    fm->c_array = av_malloc_array(fm->nb_threads,
+                                  fm->c_array_size * sizeof(*fm->c_array));
+    fm->accum   = av_malloc_array(fm->nb_threads, sizeof(*fm->accum));
+    if (!fm->tbuffer || !fm->c_array || !fm->accum)
         return AVERROR(ENOMEM);
 
     return 0;
@@ -1009,6 +1169,7 @@ static av_cold void fieldmatch_uninit(AVFilterContext *ctx)
     av_freep(&fm->cmask_data[0]);
     av_freep(&fm->tbuffer);
     av_freep(&fm->c_array);
+    av_freep(&fm->accum);
     for (i = 0; i < ctx->nb_inputs; i++)
         av_freep(&ctx->input_pads[i].name);
 }
@@ -1050,5 +1211,5 @@ AVFilter ff_vf_fieldmatch = {
     .inputs         = NULL,
     .outputs        = fieldmatch_outputs,
     .priv_class     = &fieldmatch_class,
-    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
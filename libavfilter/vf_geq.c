@@ -52,6 +52,9 @@ typedef struct GEQContext {
 
 enum { Y = 0, U, V, A, G, B, R };
 
+/* number of pixels evaluated with one av_expr_eval_array() call */
+#define GEQ_BATCH 256
+
 #define OFFSET(x) offsetof(GEQContext, x)
 #define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
 
@@ -251,9 +254,11 @@ static int slice_geq_filter(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
     const int linesize = td->linesize;
     const int slice_start = (height *  jobnr) / nb_jobs;
     const int slice_end = (height * (jobnr+1)) / nb_jobs;
-    int x, y;
+    int x, y, i;
     uint8_t *ptr;
     uint16_t *ptr16;
+    double xs[GEQ_BATCH], res[GEQ_BATCH];
+    const double *arrays[VAR_VARS_NB] = { [VAR_X] = xs };
 
     double values[VAR_VARS_NB];
     values[VAR_W] = geq->values[VAR_W];
@@ -263,25 +268,29 @@ static int slice_geq_filter(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
     values[VAR_SH] = geq->values[VAR_SH];
     values[VAR_T] = geq->values[VAR_T];
 
-    if (geq->bps == 8) {
-        for (y = slice_start; y < slice_end; y++) {
-            ptr = geq->dst + linesize * y;
-            values[VAR_Y] = y;
-
-            for (x = 0; x < width; x++) {
-                values[VAR_X] = x;
-                ptr[x] = av_expr_eval(geq->e[plane], values, geq);
-            }
-            ptr += linesize;
-        }
-    }
-    else {
-        for (y = slice_start; y < slice_end; y++) {
+    for (y = slice_start; y < slice_end; y++) {
+        if (geq->bps == 8)
+            ptr   = geq->dst + linesize * y;
+        else
             ptr16 = geq->dst16 + (linesize/2) * y;
-            values[VAR_Y] = y;
-            for (x = 0; x < width; x++) {
-                values[VAR_X] = x;
-                ptr16[x] = av_expr_eval(geq->e[plane], values, geq);
+        values[VAR_Y] = y;
+
+        for (x = 0; x < width; x += GEQ_BATCH) {
+            const int n = FFMIN(width - x, GEQ_BATCH);
+            int ret;
+
+            for (i = 0; i < n; i++)
+                xs[i] = x + i;
+            ret = av_expr_eval_array(geq->e[plane], res, n, values, arrays, geq);
+            if (ret < 0)
+                return ret;
+
+            if (geq->bps == 8) {
+                for (i = 0; i < n; i++)
+                    ptr[x + i] = res[i];
+            } else {
+                for (i = 0; i < n; i++)
+                    ptr16[x + i] = res[i];
             }
         }
     }
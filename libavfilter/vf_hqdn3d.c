@@ -54,10 +54,24 @@ static uint32_t lowpass(int prev, int cur, int16_t *coef, int depth)
     return cur + coef[d];
 }
 
+/* Number of columns a row is filtered ahead of the row below. */
+#define PROGRESS_STEP 256
+
 av_always_inline
-static void denoise_temporal(uint8_t *src, uint8_t *dst,
+static void load_row(uint8_t *src, uint16_t *frame_ant, int w, int depth)
+{
+    long x;
+
+    for (x = 0; x < w; x++)
+        frame_ant[x] = LOAD(x);
+}
+
+av_always_inline
+static void denoise_temporal(HQDN3DContext *s,
+                             uint8_t *srcp, uint8_t *dstp,
                              uint16_t *frame_ant,
                              int w, int h, int sstride, int dstride,
+                             int slice, int nb_slices,
                              int16_t *temporal, int depth)
 {
     long x, y;
@@ -65,109 +79,120 @@ static void denoise_temporal(uint8_t *src, uint8_t *dst,
 
     temporal += 256 << LUT_BITS;
 
-    for (y = 0; y < h; y++) {
+    for (y = slice; y < h; y += nb_slices) {
+        uint8_t *src = srcp + y * sstride;
+        uint8_t *dst = dstp + y * dstride;
+        uint16_t *frame_row = frame_ant + y * w;
+
+        if (!s->frame_prev_valid)
+            load_row(src, frame_row, w, depth);
         for (x = 0; x < w; x++) {
-            frame_ant[x] = tmp = lowpass(frame_ant[x], LOAD(x), temporal, depth);
+            frame_row[x] = tmp = lowpass(frame_row[x], LOAD(x), temporal, depth);
             STORE(x, tmp);
         }
-        src += sstride;
-        dst += dstride;
-        frame_ant += w;
     }
 }
 
+/*
+ * The spatial lowpass is recursive from left to right and from top to
+ * bottom, so a row can only be filtered up to the column its upper
+ * neighbor has reached. Each slice filters every nb_slices-th row, and the
+ * rows are run as a wavefront by waiting on the progress of the row above.
+ * The state carried down the columns is kept in line_ant, which the rows
+ * update in order.
+ */
 av_always_inline
 static void denoise_spatial(HQDN3DContext *s,
-                            uint8_t *src, uint8_t *dst,
+                            uint8_t *srcp, uint8_t *dstp,
                             uint16_t *line_ant, uint16_t *frame_ant,
                             int w, int h, int sstride, int dstride,
+                            int slice, int nb_slices,
                             int16_t *spatial, int16_t *temporal, int depth)
 {
-    long x, y;
+    const int step = nb_slices > 1 ? PROGRESS_STEP : w;
+    long x, x0, x1, y;
     uint32_t pixel_ant;
     uint32_t tmp;
 
     spatial  += 256 << LUT_BITS;
     temporal += 256 << LUT_BITS;
 
-    /* First line has no top neighbor. Only left one for each tmp and
-     * last frame */
-    pixel_ant = LOAD(0);
-    for (x = 0; x < w; x++) {
-        line_ant[x] = tmp = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial, depth);
-        frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
-        STORE(x, tmp);
-    }
+    for (y = slice; y < h; y += nb_slices) {
+        uint8_t *src = srcp + y * sstride;
+        uint8_t *dst = dstp + y * dstride;
+        uint16_t *frame_row = frame_ant + y * w;
+
+        if (!s->frame_prev_valid)
+            load_row(src, frame_row, w, depth);
 
-    for (y = 1; y < h; y++) {
-        src += sstride;
-        dst += dstride;
-        frame_ant += w;
-        if (s->denoise_row[depth]) {
-            s->denoise_row[depth](src, dst, line_ant, frame_ant, w, spatial, temporal);
+        if (y && s->denoise_row[depth]) {
+            s->denoise_row[depth](src, dst, line_ant, frame_row, w, spatial, temporal);
             continue;
         }
+
         pixel_ant = LOAD(0);
-        for (x = 0; x < w-1; x++) {
-            line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant, spatial, depth);
-            pixel_ant = lowpass(pixel_ant, LOAD(x+1), spatial, depth);
-            frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
-            STORE(x, tmp);
+        for (x0 = 0; x0 < w; x0 = x1) {
+            x1 = FFMIN(x0 + step, w);
+            if (!y) {
+                /* First line has no top neighbor. Only left one for each tmp
+                 * and last frame */
+                for (x = x0; x < x1; x++) {
+                    line_ant[x] = tmp = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial, depth);
+                    frame_row[x] = tmp = lowpass(frame_row[x], tmp, temporal, depth);
+                    STORE(x, tmp);
+                }
+            } else {
+                if (nb_slices > 1)
+                    ff_wavefront_wait(&s->wavefront, y - 1, x1);
+                for (x = x0; x < FFMIN(x1, w - 1); x++) {
+                    line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant, spatial, depth);
+                    pixel_ant = lowpass(pixel_ant, LOAD(x+1), spatial, depth);
+                    frame_row[x] = tmp = lowpass(frame_row[x], tmp, temporal, depth);
+                    STORE(x, tmp);
+                }
+                if (x1 == w) {
+                    line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant, spatial, depth);
+                    frame_row[x] = tmp = lowpass(frame_row[x], tmp, temporal, depth);
+                    STORE(x, tmp);
+                }
+            }
+            if (nb_slices > 1)
+                ff_wavefront_report(&s->wavefront, y, x1);
         }
-        line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant, spatial, depth);
-        frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
-        STORE(x, tmp);
     }
 }
 
 av_always_inline
 static int denoise_depth(HQDN3DContext *s,
                          uint8_t *src, uint8_t *dst,
-                         uint16_t *line_ant, uint16_t **frame_ant_ptr,
+                         uint16_t *line_ant, uint16_t *frame_ant,
                          int w, int h, int sstride, int dstride,
+                         int slice, int nb_slices,
                          int16_t *spatial, int16_t *temporal, int depth)
 {
     // FIXME: For 16-bit depth, frame_ant could be a pointer to the previous
     // filtered frame rather than a separate buffer.
-    long x, y;
-    uint16_t *frame_ant = *frame_ant_ptr;
-    if (!frame_ant) {
-        uint8_t *frame_src = src;
-        *frame_ant_ptr = frame_ant = av_malloc_array(w, h*sizeof(uint16_t));
-        if (!frame_ant)
-            return AVERROR(ENOMEM);
-        for (y = 0; y < h; y++, src += sstride, frame_ant += w)
-            for (x = 0; x < w; x++)
-                frame_ant[x] = LOAD(x);
-        src = frame_src;
-        frame_ant = *frame_ant_ptr;
-    }
-
     if (spatial[0])
         denoise_spatial(s, src, dst, line_ant, frame_ant,
-                        w, h, sstride, dstride, spatial, temporal, depth);
+                        w, h, sstride, dstride, slice, nb_slices,
+                        spatial, temporal, depth);
     else
-        denoise_temporal(src, dst, frame_ant,
-                         w, h, sstride, dstride, temporal, depth);
+        denoise_temporal(s, src, dst, frame_ant,
+                         w, h, sstride, dstride, slice, nb_slices,
+                         temporal, depth);
     emms_c();
     return 0;
 }
 
 #define denoise(...)                                                          \
     do {                                                                      \
-        int ret = AVERROR_BUG;                                                \
         switch (s->depth) {                                                   \
-            case  8: ret = denoise_depth(__VA_ARGS__,  8); break;             \
-            case  9: ret = denoise_depth(__VA_ARGS__,  9); break;             \
-            case 10: ret = denoise_depth(__VA_ARGS__, 10); break;             \
-            case 16: ret = denoise_depth(__VA_ARGS__, 16); break;             \
-        }                                                                     \
-        if (ret < 0) {                                                        \
-            av_frame_free(&out);                                              \
-            if (!direct)                                                      \
-                av_frame_free(&in);                                           \
-            return ret;                                                       \
+            case  8: return denoise_depth(__VA_ARGS__,  8);                   \
+            case  9: return denoise_depth(__VA_ARGS__,  9);                   \
+            case 10: return denoise_depth(__VA_ARGS__, 10);                   \
+            case 16: return denoise_depth(__VA_ARGS__, 16);                   \
         }                                                                     \
+        return AVERROR_BUG;                                                   \
     } while (0)
 
 static int16_t *precalc_coefs(double dist25, int depth)
@@ -215,20 +240,28 @@ static av_cold int init(AVFilterContext *ctx)
     return 0;
 }
 
-static av_cold void uninit(AVFilterContext *ctx)
+static void free_buffers(HQDN3DContext *s)
 {
-    HQDN3DContext *s = ctx->priv;
-
     av_freep(&s->coefs[0]);
     av_freep(&s->coefs[1]);
     av_freep(&s->coefs[2]);
     av_freep(&s->coefs[3]);
-    av_freep(&s->line);
+    av_freep(&s->line[0]);
+    av_freep(&s->line[1]);
+    av_freep(&s->line[2]);
     av_freep(&s->frame_prev[0]);
     av_freep(&s->frame_prev[1]);
     av_freep(&s->frame_prev[2]);
 }
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    HQDN3DContext *s = ctx->priv;
+
+    free_buffers(s);
+    ff_wavefront_uninit(&s->wavefront);
+}
+
 static int query_formats(AVFilterContext *ctx)
 {
     static const enum AVPixelFormat pix_fmts[] = {
@@ -263,17 +296,27 @@ static int config_input(AVFilterLink *inlink)
 {
     HQDN3DContext *s = inlink->dst->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
-    int i;
+    int i, ret;
 
-    uninit(inlink->dst);
+    free_buffers(s);
 
     s->hsub  = desc->log2_chroma_w;
     s->vsub  = desc->log2_chroma_h;
     s->depth = desc->comp[0].depth;
+    s->frame_prev_valid = 0;
 
-    s->line = av_malloc_array(inlink->w, sizeof(*s->line));
-    if (!s->line)
-        return AVERROR(ENOMEM);
+    for (i = 0; i < 3; i++) {
+        const int w = AV_CEIL_RSHIFT(inlink->w, (!!i * s->hsub));
+        const int h = AV_CEIL_RSHIFT(inlink->h, (!!i * s->vsub));
+
+        s->line[i] = av_malloc_array(w, sizeof(*s->line[i]));
+        s->frame_prev[i] = av_malloc_array(w, h * sizeof(*s->frame_prev[i]));
+        if (!s->line[i] || !s->frame_prev[i])
+            return AVERROR(ENOMEM);
+    }
+
+    if ((ret = ff_wavefront_init(&s->wavefront, inlink->h)) < 0)
+        return ret;
 
     for (i = 0; i < 4; i++) {
         s->coefs[i] = precalc_coefs(s->strength[i], s->depth);
@@ -287,13 +330,52 @@ static int config_input(AVFilterLink *inlink)
     return 0;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int plane;
+    int nb_slices;
+} ThreadData;
+
+static int denoise_plane(HQDN3DContext *s, AVFrame *in, AVFrame *out,
+                         int c, int slice, int nb_slices)
+{
+    denoise(s, in->data[c], out->data[c],
+            s->line[c], s->frame_prev[c],
+            AV_CEIL_RSHIFT(in->width,  (!!c * s->hsub)),
+            AV_CEIL_RSHIFT(in->height, (!!c * s->vsub)),
+            in->linesize[c], out->linesize[c],
+            slice, nb_slices,
+            s->coefs[c ? CHROMA_SPATIAL : LUMA_SPATIAL],
+            s->coefs[c ? CHROMA_TMP     : LUMA_TMP]);
+}
+
+static int do_denoise(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const ThreadData *td = arg;
+
+    return denoise_plane(ctx->priv, td->in, td->out, td->plane, jobnr, td->nb_slices);
+}
+
+/* Each job filters whole planes with the SIMD row kernel. */
+static int do_denoise_planes(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const ThreadData *td = arg;
+    int c, ret;
+
+    for (c = jobnr; c < 3; c += nb_jobs)
+        if ((ret = denoise_plane(ctx->priv, td->in, td->out, c, 0, 1)) < 0)
+            return ret;
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx  = inlink->dst;
-    HQDN3DContext *s = ctx->priv;
+    HQDN3DContext *s      = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
 
     AVFrame *out;
+    ThreadData td;
     int c, direct = av_frame_is_writable(in) && !ctx->is_disabled;
 
     if (direct) {
@@ -308,15 +390,29 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
     }
 
-    for (c = 0; c < 3; c++) {
-        denoise(s, in->data[c], out->data[c],
-                s->line, &s->frame_prev[c],
-                AV_CEIL_RSHIFT(in->width,  (!!c * s->hsub)),
-                AV_CEIL_RSHIFT(in->height, (!!c * s->vsub)),
-                in->linesize[c], out->linesize[c],
-                s->coefs[c ? CHROMA_SPATIAL : LUMA_SPATIAL],
-                s->coefs[c ? CHROMA_TMP     : LUMA_TMP]);
+    td.in  = in;
+    td.out = out;
+    if (s->denoise_row[s->depth]) {
+        /* The SIMD kernel needs the complete row above, which leaves no room
+         * for a wavefront, so the planes are filtered in parallel instead. */
+        ctx->internal->execute(ctx, do_denoise_planes, &td, NULL,
+                               FFMIN(3, ff_filter_get_nb_threads(ctx)));
+    } else {
+        for (c = 0; c < 3; c++) {
+            const int h = AV_CEIL_RSHIFT(in->height, (!!c * s->vsub));
+            const int spatial = s->coefs[c ? CHROMA_SPATIAL : LUMA_SPATIAL][0];
+
+            /* The spatial rows wait for the row above, the temporal ones
+             * are independent. */
+            td.plane     = c;
+            td.nb_slices = FFMIN(h, spatial ? ff_wavefront_max_jobs(ctx)
+                                            : ff_filter_get_nb_threads(ctx));
+            if (td.nb_slices > 1 && spatial)
+                ff_wavefront_reset(&s->wavefront);
+            ctx->internal->execute(ctx, do_denoise, &td, NULL, td.nb_slices);
+        }
     }
+    s->frame_prev_valid = 1;
 
     if (ctx->is_disabled) {
         av_frame_free(&out);
@@ -370,5 +466,5 @@ AVFilter ff_vf_hqdn3d = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_hqdn3d_inputs,
     .outputs       = avfilter_vf_hqdn3d_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_SLICE_THREADS,
 };
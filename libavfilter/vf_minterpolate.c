@@ -31,6 +31,7 @@
 #include "internal.h"
 #include "video.h"
 #include "scene_sad.h"
+#include "wavefront.h"
 
 #define ME_MODE_BIDIR 0
 #define ME_MODE_BILAT 1
@@ -195,6 +196,10 @@ typedef struct MIContext {
     int log2_chroma_w;
     int log2_chroma_h;
     int nb_planes;
+
+    /* number of searched blocks of the predictive searches, per direction
+     * and block row */
+    FFWavefront wavefront;
 } MIContext;
 
 #define OFFSET(x) offsetof(MIContext, x)
@@ -260,6 +265,7 @@ static uint64_t get_sbad(AVMotionEstContext *me_ctx, int x, int y, int x_mv, int
     uint8_t *data_cur = me_ctx->data_cur;
     uint8_t *data_next = me_ctx->data_ref;
     int linesize = me_ctx->linesize;
+    av_pixelutils_sad_fn sad_fn = ff_me_get_sad_fn(me_ctx, me_ctx->mb_size);
     int mv_x1 = x_mv - x;
     int mv_y1 = y_mv - y;
     int mv_x, mv_y, i, j;
@@ -273,9 +279,13 @@ static uint64_t get_sbad(AVMotionEstContext *me_ctx, int x, int y, int x_mv, int
     data_cur += (y + mv_y) * linesize;
     data_next += (y - mv_y) * linesize;
 
-    for (j = 0; j < me_ctx->mb_size; j++)
-        for (i = 0; i < me_ctx->mb_size; i++)
-            sbad += FFABS(data_cur[x + mv_x + i + j * linesize] - data_next[x - mv_x + i + j * linesize]);
+    if (sad_fn) {
+        sbad = sad_fn(data_cur + x + mv_x, linesize, data_next + x - mv_x, linesize);
+    } else {
+        for (j = 0; j < me_ctx->mb_size; j++)
+            for (i = 0; i < me_ctx->mb_size; i++)
+                sbad += FFABS(data_cur[x + mv_x + i + j * linesize] - data_next[x - mv_x + i + j * linesize]);
+    }
 
     return sbad + (FFABS(mv_x1 - me_ctx->pred_x) + FFABS(mv_y1 - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -289,6 +299,8 @@ static uint64_t get_sbad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv,
     int x_max = me_ctx->x_max - me_ctx->mb_size / 2;
     int y_min = me_ctx->y_min + me_ctx->mb_size / 2;
     int y_max = me_ctx->y_max - me_ctx->mb_size / 2;
+    /* the overlapped window is 2 * mb_size wide when mb_size is even */
+    av_pixelutils_sad_fn sad_fn = me_ctx->mb_size > 1 ? ff_me_get_sad_fn(me_ctx, me_ctx->mb_size * 2) : NULL;
     int mv_x1 = x_mv - x;
     int mv_y1 = y_mv - y;
     int mv_x, mv_y, i, j;
@@ -299,9 +311,15 @@ static uint64_t get_sbad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv,
     mv_x = av_clip(x_mv - x, -FFMIN(x - x_min, x_max - x), FFMIN(x - x_min, x_max - x));
     mv_y = av_clip(y_mv - y, -FFMIN(y - y_min, y_max - y), FFMIN(y - y_min, y_max - y));
 
-    for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
-        for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
-            sbad += FFABS(data_cur[x + mv_x + i + (y + mv_y + j) * linesize] - data_next[x - mv_x + i + (y - mv_y + j) * linesize]);
+    if (sad_fn) {
+        const int off = me_ctx->mb_size / 2;
+        sbad = sad_fn(data_cur  + x + mv_x - off + (y + mv_y - off) * linesize, linesize,
+                      data_next + x - mv_x - off + (y - mv_y - off) * linesize, linesize);
+    } else {
+        for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
+            for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
+                sbad += FFABS(data_cur[x + mv_x + i + (y + mv_y + j) * linesize] - data_next[x - mv_x + i + (y - mv_y + j) * linesize]);
+    }
 
     return sbad + (FFABS(mv_x1 - me_ctx->pred_x) + FFABS(mv_y1 - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -315,6 +333,7 @@ static uint64_t get_sad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv, i
     int x_max = me_ctx->x_max - me_ctx->mb_size / 2;
     int y_min = me_ctx->y_min + me_ctx->mb_size / 2;
     int y_max = me_ctx->y_max - me_ctx->mb_size / 2;
+    av_pixelutils_sad_fn sad_fn = me_ctx->mb_size > 1 ? ff_me_get_sad_fn(me_ctx, me_ctx->mb_size * 2) : NULL;
     int mv_x = x_mv - x;
     int mv_y = y_mv - y;
     int i, j;
@@ -325,9 +344,15 @@ static uint64_t get_sad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv, i
     x_mv = av_clip(x_mv, x_min, x_max);
     y_mv = av_clip(y_mv, y_min, y_max);
 
-    for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
-        for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
-            sad += FFABS(data_ref[x_mv + i + (y_mv + j) * linesize] - data_cur[x + i + (y + j) * linesize]);
+    if (sad_fn) {
+        const int off = me_ctx->mb_size / 2;
+        sad = sad_fn(data_ref + x_mv - off + (y_mv - off) * linesize, linesize,
+                     data_cur + x    - off + (y    - off) * linesize, linesize);
+    } else {
+        for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
+            for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
+                sad += FFABS(data_ref[x_mv + i + (y_mv + j) * linesize] - data_cur[x + i + (y + j) * linesize]);
+    }
 
     return sad + (FFABS(mv_x - me_ctx->pred_x) + FFABS(mv_y - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -360,6 +385,9 @@ static int config_input(AVFilterLink *inlink)
             return AVERROR(ENOMEM);
     }
 
+    if ((ret = ff_wavefront_init(&mi_ctx->wavefront, 2 * mi_ctx->b_height)) < 0)
+        return ret;
+
     if (mi_ctx->mi_mode == MI_MODE_MCI) {
         mi_ctx->pixel_mvs = av_mallocz_array(width * height, sizeof(PixelMVS));
         mi_ctx->pixel_weights = av_mallocz_array(width * height, sizeof(PixelWeights));
@@ -422,9 +450,8 @@ static int config_output(AVFilterLink *outlink)
         preds.nb++;\
     } while(0)
 
-static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int dir)
+static void search_mv(MIContext *mi_ctx, AVMotionEstContext *me_ctx, Block *blocks, int mb_x, int mb_y, int dir)
 {
-    AVMotionEstContext *me_ctx = &mi_ctx->me_ctx;
     AVMotionEstPredictor *preds = me_ctx->preds;
     Block *block = &blocks[mb_x + mb_y * mi_ctx->b_width];
 
@@ -564,8 +591,90 @@ static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int
     block->mvs[dir][1] = mv[1] - y_mb;
 }
 
-static void bilateral_me(MIContext *mi_ctx)
+typedef struct SearchThreadData {
+    Block *blocks;
+    AVMotionEstContext me_ctx[2];
+    int nb_dirs;
+    int nb_slices;
+    int wavefront;
+} SearchThreadData;
+
+/*
+ * Each job searches every nb_slices-th block row of one direction. The
+ * predictive searches use the vectors of the left, top and top-right blocks,
+ * so for those a block is only searched once the row above is two blocks
+ * ahead, which runs the rows as a wavefront.
+ */
+static int search_mv_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    SearchThreadData *td = arg;
+    const int dir = jobnr / td->nb_slices;
+    const int slice = jobnr % td->nb_slices;
+    const int row0 = dir * mi_ctx->b_height;
+    AVMotionEstContext me_ctx = td->me_ctx[dir];
+    int mb_x, mb_y;
+
+    for (mb_y = slice; mb_y < mi_ctx->b_height; mb_y += td->nb_slices)
+        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
+            if (td->wavefront && mb_y > 0)
+                ff_wavefront_wait(&mi_ctx->wavefront, row0 + mb_y - 1,
+                                  FFMIN(mb_x + 2, mi_ctx->b_width));
+            search_mv(mi_ctx, &me_ctx, td->blocks, mb_x, mb_y, dir);
+            if (td->wavefront)
+                ff_wavefront_report(&mi_ctx->wavefront, row0 + mb_y, mb_x + 1);
+        }
+
+    emms_c();
+
+    /* the predictor of the last block is reused by the later stages */
+    if (dir == td->nb_dirs - 1 && slice == (mi_ctx->b_height - 1) % td->nb_slices) {
+        mi_ctx->me_ctx.pred_x = me_ctx.pred_x;
+        mi_ctx->me_ctx.pred_y = me_ctx.pred_y;
+    }
+
+    return 0;
+}
+
+/**
+ * Run the block search for nb_dirs directions, the first and last
+ * directions use frames[ref[0]] and frames[ref[1]] as reference.
+ */
+static void search_mvs(AVFilterContext *ctx, Block *blocks, int nb_dirs, int cur, const int *ref)
+{
+    MIContext *mi_ctx = ctx->priv;
+    SearchThreadData td;
+    int dir, nb_jobs;
+
+    /* The predictive searches wait for the row above, which is only safe
+     * if all jobs run concurrently, the other ones can be split freely. */
+    if (mi_ctx->me_method == AV_ME_METHOD_EPZS || mi_ctx->me_method == AV_ME_METHOD_UMH)
+        nb_jobs = ff_wavefront_max_jobs(ctx);
+    else
+        nb_jobs = ff_filter_get_nb_threads(ctx);
+    td.nb_dirs   = nb_dirs;
+    td.nb_slices = FFMAX(1, FFMIN(mi_ctx->b_height, nb_jobs / nb_dirs));
+    td.wavefront = td.nb_slices > 1 &&
+                   (mi_ctx->me_method == AV_ME_METHOD_EPZS || mi_ctx->me_method == AV_ME_METHOD_UMH);
+
+    if (td.wavefront)
+        ff_wavefront_reset(&mi_ctx->wavefront);
+
+    for (dir = 0; dir < nb_dirs; dir++) {
+        mi_ctx->me_ctx.linesize = mi_ctx->frames[cur].avf->linesize[0];
+        mi_ctx->me_ctx.data_cur = mi_ctx->frames[cur].avf->data[0];
+        mi_ctx->me_ctx.data_ref = mi_ctx->frames[ref[dir]].avf->data[0];
+        td.me_ctx[dir] = mi_ctx->me_ctx;
+    }
+    td.blocks = blocks;
+
+    ctx->internal->execute(ctx, search_mv_slice, &td, NULL, nb_dirs * td.nb_slices);
+}
+
+static void bilateral_me(AVFilterContext *ctx)
 {
+    MIContext *mi_ctx = ctx->priv;
+    const int ref[1] = { 2 };
     Block *block;
     int mb_x, mb_y;
 
@@ -580,9 +689,7 @@ static void bilateral_me(MIContext *mi_ctx)
             block->mvs[0][1] = 0;
         }
 
-    for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++)
-            search_mv(mi_ctx, mi_ctx->int_blocks, mb_x, mb_y, 0);
+    search_mvs(ctx, mi_ctx->int_blocks, 1, 1, ref);
 }
 
 static int var_size_bme(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n)
@@ -727,7 +834,9 @@ static int cluster_mvs(MIContext *mi_ctx)
                     if (block->cid != mi_ctx->int_blocks[x + y * mi_ctx->b_width].cid) {
                         if (!dx && block->cid == mi_ctx->int_blocks[x + (mb_y - dy) * mi_ctx->b_width].cid ||
                             !dy && block->cid == mi_ctx->int_blocks[(mb_x - dx) + y * mi_ctx->b_width].cid) {
-                            if (ret = var_size_bme(mi_ctx, block, mb_x << mi_ctx->log2_mb_size, mb_y << mi_ctx->log2_mb_size, mi_ctx->log2_mb_size))
+                            ret = var_size_bme(mi_ctx, block, mb_x << mi_ctx->log2_mb_size, mb_y << mi_ctx->log2_mb_size, mi_ctx->log2_mb_size);
+                            emms_c();
+                            if (ret)
                                 return ret;
                         }
                     }
@@ -742,7 +851,7 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
     AVFilterContext *ctx = inlink->dst;
     MIContext *mi_ctx = ctx->priv;
     Frame frame_tmp;
-    int mb_x, mb_y, dir;
+    int mb_x, mb_y;
 
     av_frame_free(&mi_ctx->frames[0].avf);
     frame_tmp = mi_ctx->frames[0];
@@ -760,15 +869,8 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
         if (mi_ctx->me_mode == ME_MODE_BIDIR) {
 
             if (mi_ctx->frames[1].avf) {
-                for (dir = 0; dir < 2; dir++) {
-                    mi_ctx->me_ctx.linesize = mi_ctx->frames[2].avf->linesize[0];
-                    mi_ctx->me_ctx.data_cur = mi_ctx->frames[2].avf->data[0];
-                    mi_ctx->me_ctx.data_ref = mi_ctx->frames[dir ? 3 : 1].avf->data[0];
-
-                    for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-                        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++)
-                            search_mv(mi_ctx, mi_ctx->frames[2].blocks, mb_x, mb_y, dir);
-                }
+                const int ref[2] = { 1, 3 };
+                search_mvs(ctx, mi_ctx->frames[2].blocks, 2, 2, ref);
             }
 
         } else if (mi_ctx->me_mode == ME_MODE_BILAT) {
@@ -778,11 +880,7 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
             if (!mi_ctx->frames[0].avf)
                 return 0;
 
-            mi_ctx->me_ctx.linesize = mi_ctx->frames[0].avf->linesize[0];
-            mi_ctx->me_ctx.data_cur = mi_ctx->frames[1].avf->data[0];
-            mi_ctx->me_ctx.data_ref = mi_ctx->frames[2].avf->data[0];
-
-            bilateral_me(mi_ctx);
+            bilateral_me(ctx);
 
             if (mi_ctx->mc_mode == MC_MODE_AOBMC) {
 
@@ -794,6 +892,7 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
 
                         block->sbad = get_sbad(&mi_ctx->me_ctx, x_mb, y_mb, x_mb + block->mvs[0][0], y_mb + block->mvs[0][1]);
                     }
+                emms_c();
             }
 
             if (mi_ctx->vsbmc) {
@@ -913,16 +1012,28 @@ static void bidirectional_obmc(MIContext *mi_ctx, int alpha)
             }
 }
 
-static void set_frame_data(MIContext *mi_ctx, int alpha, AVFrame *avf_out)
+typedef struct InterpolateThreadData {
+    AVFrame *out;
+    int alpha;
+} InterpolateThreadData;
+
+static int set_frame_data(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    MIContext *mi_ctx = ctx->priv;
+    InterpolateThreadData *td = arg;
+    AVFrame *avf_out = td->out;
+    const int alpha = td->alpha;
+    /* keep all the luma rows mapping to the same chroma row in one slice */
+    const int rows = AV_CEIL_RSHIFT(avf_out->height, mi_ctx->log2_chroma_h);
+    const int slice_start = ((rows *  jobnr     ) / nb_jobs) << mi_ctx->log2_chroma_h;
+    const int slice_end   = FFMIN(((rows * (jobnr + 1)) / nb_jobs) << mi_ctx->log2_chroma_h, avf_out->height);
     int x, y, plane;
 
     for (plane = 0; plane < mi_ctx->nb_planes; plane++) {
         int width = avf_out->width;
-        int height = avf_out->height;
         int chroma = plane == 1 || plane == 2;
 
-        for (y = 0; y < height; y++)
+        for (y = slice_start; y < slice_end; y++)
             for (x = 0; x < width; x++) {
                 int x_mv, y_mv;
                 int weight_sum = 0;
@@ -969,6 +1080,8 @@ static void set_frame_data(MIContext *mi_ctx, int alpha, AVFrame *avf_out)
                     avf_out->data[plane][x + y * avf_out->linesize[plane]] = val;
             }
     }
+
+    return 0;
 }
 
 static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n, int alpha)
@@ -1079,6 +1192,7 @@ static void interpolate(AVFilterLink *inlink, AVFrame *avf_out)
     AVFilterContext *ctx = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     MIContext *mi_ctx = ctx->priv;
+    InterpolateThreadData td;
     int x, y;
     int plane, alpha;
     int64_t pts;
@@ -1128,7 +1242,10 @@ static void interpolate(AVFilterLink *inlink, AVFrame *avf_out)
         case MI_MODE_MCI:
             if (mi_ctx->me_mode == ME_MODE_BIDIR) {
                 bidirectional_obmc(mi_ctx, alpha);
-                set_frame_data(mi_ctx, alpha, avf_out);
+                td.out = avf_out;
+                td.alpha = alpha;
+                ctx->internal->execute(ctx, set_frame_data, &td, NULL,
+                                       FFMIN(avf_out->height, ff_filter_get_nb_threads(ctx)));
 
             } else if (mi_ctx->me_mode == ME_MODE_BILAT) {
                 int mb_x, mb_y;
@@ -1149,7 +1266,10 @@ static void interpolate(AVFilterLink *inlink, AVFrame *avf_out)
 
                     }
 
-                set_frame_data(mi_ctx, alpha, avf_out);
+                td.out = avf_out;
+                td.alpha = alpha;
+                ctx->internal->execute(ctx, set_frame_data, &td, NULL,
+                                       FFMIN(avf_out->height, ff_filter_get_nb_threads(ctx)));
             }
 
             break;
@@ -1235,6 +1355,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     for (i = 0; i < 3; i++)
         av_freep(&mi_ctx->mv_table[i]);
+
+    ff_wavefront_uninit(&mi_ctx->wavefront);
 }
 
 static const AVFilterPad minterpolate_inputs[] = {
@@ -1265,4 +1387,5 @@ AVFilter ff_vf_minterpolate = {
     .query_formats = query_formats,
     .inputs        = minterpolate_inputs,
     .outputs       = minterpolate_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
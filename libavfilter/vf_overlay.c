@@ -83,6 +83,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     OverlayContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
+    av_frame_free(&s->overlay_ref);
     av_expr_free(s->x_pexpr); s->x_pexpr = NULL;
     av_expr_free(s->y_pexpr); s->y_pexpr = NULL;
 }
@@ -379,21 +380,23 @@ static av_always_inline void blend_slice_packed_rgb(AVFilterContext *ctx,
     int slice_start, slice_end;
     uint8_t *S, *sp, *d, *dp;
 
-    i = FFMAX(-y, 0);
-    imax = FFMIN(-y + dst_h, src_h);
+    i = FFMAX(-y, s->box_y0);
+    imax = FFMIN3(-y + dst_h, src_h, s->box_y1);
+    if (i >= imax)
+        return;
 
-    slice_start = (imax * jobnr) / nb_jobs;
-    slice_end = (imax * (jobnr+1)) / nb_jobs;
+    slice_start = i + ((imax - i) * jobnr) / nb_jobs;
+    slice_end   = i + ((imax - i) * (jobnr+1)) / nb_jobs;
 
-    sp = src->data[0] + (i + slice_start)     * src->linesize[0];
-    dp = dst->data[0] + (y + i + slice_start) * dst->linesize[0];
+    sp = src->data[0] + slice_start       * src->linesize[0];
+    dp = dst->data[0] + (y + slice_start) * dst->linesize[0];
 
-    for (i = i + slice_start; i < slice_end; i++) {
-        j = FFMAX(-x, 0);
+    for (i = slice_start; i < slice_end; i++) {
+        j = FFMAX(-x, s->box_x0);
         S = sp + j     * sstep;
         d = dp + (x+j) * dstep;
 
-        for (jmax = FFMIN(-x + dst_w, src_w); j < jmax; j++) {
+        for (jmax = FFMIN3(-x + dst_w, src_w, s->box_x1); j < jmax; j++) {
             alpha = S[sa];
 
             // if the main channel has an alpha channel, alpha has to be calculated
@@ -463,30 +466,37 @@ static av_always_inline void blend_plane(AVFilterContext *ctx,
     int dst_hp = AV_CEIL_RSHIFT(dst_h, vsub);
     int yp = y>>vsub;
     int xp = x>>hsub;
+    /* chroma samples outside of these bounds only average fully transparent pixels */
+    int box_x0 = octx->box_x0 >> hsub;
+    int box_y0 = octx->box_y0 >> vsub;
+    int box_x1 = AV_CEIL_RSHIFT(octx->box_x1, hsub);
+    int box_y1 = AV_CEIL_RSHIFT(octx->box_y1, vsub);
     uint8_t *s, *sp, *d, *dp, *dap, *a, *da, *ap;
     int jmax, j, k, kmax;
     int slice_start, slice_end;
 
-    j = FFMAX(-yp, 0);
-    jmax = FFMIN(-yp + dst_hp, src_hp);
+    j = FFMAX(-yp, box_y0);
+    jmax = FFMIN3(-yp + dst_hp, src_hp, box_y1);
+    if (j >= jmax)
+        return;
 
-    slice_start = (jmax * jobnr) / nb_jobs;
-    slice_end = (jmax * (jobnr+1)) / nb_jobs;
+    slice_start = j + ((jmax - j) * jobnr) / nb_jobs;
+    slice_end   = j + ((jmax - j) * (jobnr+1)) / nb_jobs;
 
-    sp = src->data[i] + (j + slice_start) * src->linesize[i];
+    sp = src->data[i] + slice_start * src->linesize[i];
     dp = dst->data[dst_plane]
-                      + (yp + j + slice_start) * dst->linesize[dst_plane]
+                      + (yp + slice_start) * dst->linesize[dst_plane]
                       + dst_offset;
-    ap = src->data[3] + (j + slice_start << vsub) * src->linesize[3];
-    dap = dst->data[3] + ((yp + j + slice_start) << vsub) * dst->linesize[3];
+    ap = src->data[3] + (slice_start << vsub) * src->linesize[3];
+    dap = dst->data[3] + ((yp + slice_start) << vsub) * dst->linesize[3];
 
-    for (j = j + slice_start; j < slice_end; j++) {
-        k = FFMAX(-xp, 0);
+    for (j = slice_start; j < slice_end; j++) {
+        k = FFMAX(-xp, box_x0);
         d = dp + (xp+k) * dst_step;
         s = sp + k;
         a = ap + (k<<hsub);
         da = dap + ((xp+k) << hsub);
-        kmax = FFMIN(-xp + dst_wp, src_wp);
+        kmax = FFMIN3(-xp + dst_wp, src_wp, box_x1);
 
         if (((vsub && j+1 < src_hp) || !vsub) && octx->blend_row[i]) {
             int c = octx->blend_row[i](d, da, s, a, kmax - k, src->linesize[3]);
@@ -550,7 +560,8 @@ static av_always_inline void blend_plane(AVFilterContext *ctx,
     }
 }
 
-static inline void alpha_composite(const AVFrame *src, const AVFrame *dst,
+static inline void alpha_composite(const OverlayContext *octx,
+                                   const AVFrame *src, const AVFrame *dst,
                                    int src_w, int src_h,
                                    int dst_w, int dst_h,
                                    int x, int y,
@@ -561,20 +572,23 @@ static inline void alpha_composite(const AVFrame *src, const AVFrame *dst,
     int i, imax, j, jmax;
     int slice_start, slice_end;
 
-    imax = FFMIN(-y + dst_h, src_h);
-    slice_start = (imax * jobnr) / nb_jobs;
-    slice_end = ((imax * (jobnr+1)) / nb_jobs);
+    i = FFMAX(-y, octx->box_y0);
+    imax = FFMIN3(-y + dst_h, src_h, octx->box_y1);
+    if (i >= imax)
+        return;
 
-    i = FFMAX(-y, 0);
-    sa = src->data[3] + (i + slice_start) * src->linesize[3];
-    da = dst->data[3] + (y + i + slice_start) * dst->linesize[3];
+    slice_start = i + ((imax - i) * jobnr) / nb_jobs;
+    slice_end   = i + ((imax - i) * (jobnr+1)) / nb_jobs;
 
-    for (i = i + slice_start; i < slice_end; i++) {
-        j = FFMAX(-x, 0);
+    sa = src->data[3] + slice_start       * src->linesize[3];
+    da = dst->data[3] + (y + slice_start) * dst->linesize[3];
+
+    for (i = slice_start; i < slice_end; i++) {
+        j = FFMAX(-x, octx->box_x0);
         s = sa + j;
         d = da + x+j;
 
-        for (jmax = FFMIN(-x + dst_w, src_w); j < jmax; j++) {
+        for (jmax = FFMIN3(-x + dst_w, src_w, octx->box_x1); j < jmax; j++) {
             alpha = *s;
             if (alpha != 0 && alpha != 255) {
                 uint8_t alpha_d = *d;
@@ -623,7 +637,7 @@ static av_always_inline void blend_slice_yuv(AVFilterContext *ctx,
                 jobnr, nb_jobs);
 
     if (main_has_alpha)
-        alpha_composite(src, dst, src_w, src_h, dst_w, dst_h, x, y, jobnr, nb_jobs);
+        alpha_composite(s, src, dst, src_w, src_h, dst_w, dst_h, x, y, jobnr, nb_jobs);
 }
 
 static av_always_inline void blend_slice_planar_rgb(AVFilterContext *ctx,
@@ -652,7 +666,7 @@ static av_always_inline void blend_slice_planar_rgb(AVFilterContext *ctx,
                 jobnr, nb_jobs);
 
     if (main_has_alpha)
-        alpha_composite(src, dst, src_w, src_h, dst_w, dst_h, x, y, jobnr, nb_jobs);
+        alpha_composite(s, src, dst, src_w, src_h, dst_w, dst_h, x, y, jobnr, nb_jobs);
 }
 
 static int blend_slice_yuv420(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
@@ -927,6 +941,63 @@ end:
     return 0;
 }
 
+/**
+ * Compute the bounding box of the pixels of the overlay which change the
+ * main picture. With straight alpha these are the non-transparent ones.
+ * The box is kept as long as the same overlay picture is repeated, as with
+ * a still logo.
+ */
+static int update_overlay_box(AVFilterContext *ctx, AVFrame *overlay)
+{
+    OverlayContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(overlay->format);
+    const uint8_t *alpha;
+    ptrdiff_t linesize;
+    int step, x, y, ret;
+
+    if (s->overlay_ref->buf[0] &&
+        s->overlay_ref->data[0] == overlay->data[0] &&
+        s->overlay_ref->width   == overlay->width  &&
+        s->overlay_ref->height  == overlay->height)
+        return 0;
+
+    /* holding a reference guarantees the data is not reused or modified */
+    av_frame_unref(s->overlay_ref);
+    if ((ret = av_frame_ref(s->overlay_ref, overlay)) < 0)
+        return ret;
+
+    s->box_x0 = 0;
+    s->box_y0 = 0;
+    s->box_x1 = overlay->width;
+    s->box_y1 = overlay->height;
+
+    /* premultiplied colors are added even where alpha is 0 */
+    if (s->alpha_format)
+        return 0;
+
+    alpha    = overlay->data[desc->comp[3].plane] + desc->comp[3].offset;
+    linesize = overlay->linesize[desc->comp[3].plane];
+    step     = desc->comp[3].step;
+
+    s->box_x0 = overlay->width;
+    s->box_y0 = overlay->height;
+    s->box_x1 = 0;
+    s->box_y1 = 0;
+    for (y = 0; y < overlay->height; y++) {
+        for (x = 0; x < overlay->width; x++) {
+            if (alpha[x * step]) {
+                s->box_x0 = FFMIN(s->box_x0, x);
+                s->box_x1 = FFMAX(s->box_x1, x + 1);
+                s->box_y0 = FFMIN(s->box_y0, y);
+                s->box_y1 = y + 1;
+            }
+        }
+        alpha += linesize;
+    }
+
+    return 0;
+}
+
 static int do_blend(FFFrameSync *fs)
 {
     AVFilterContext *ctx = fs->parent;
@@ -961,13 +1032,20 @@ static int do_blend(FFFrameSync *fs)
                s->var_values[VAR_Y], s->y);
     }
 
-    if (s->x < mainpic->width  && s->x + second->width  >= 0 ||
-        s->y < mainpic->height && s->y + second->height >= 0) {
+    if ((ret = update_overlay_box(ctx, second)) < 0) {
+        av_frame_free(&mainpic);
+        return ret;
+    }
+
+    if (s->box_x0 < s->box_x1 && s->box_y0 < s->box_y1 &&
+        s->x + s->box_x0 < mainpic->width  && s->x + s->box_x1 > 0 &&
+        s->y + s->box_y0 < mainpic->height && s->y + s->box_y1 > 0) {
         ThreadData td;
+        int nb_rows = FFMIN(mainpic->height - s->y, s->box_y1) - FFMAX(-s->y, s->box_y0);
 
         td.dst = mainpic;
         td.src = second;
-        ctx->internal->execute(ctx, s->blend_slice, &td, NULL, FFMIN(FFMIN(mainpic->height - s->y, second->height),
+        ctx->internal->execute(ctx, s->blend_slice, &td, NULL, FFMIN(nb_rows,
                                                                      ff_filter_get_nb_threads(ctx)));
     }
     return ff_filter_frame(ctx->outputs[0], mainpic);
@@ -977,6 +1055,10 @@ static av_cold int init(AVFilterContext *ctx)
 {
     OverlayContext *s = ctx->priv;
 
+    s->overlay_ref = av_frame_alloc();
+    if (!s->overlay_ref)
+        return AVERROR(ENOMEM);
+
     s->fs.on_event = do_blend;
     return 0;
 }
@@ -75,6 +75,10 @@ typedef struct OverlayContext {
 
     AVExpr *x_pexpr, *y_pexpr;
 
+    AVFrame *overlay_ref;       ///< overlay frame the bounding box below was computed for
+    int box_x0, box_y0;         ///< top left corner of the area of the overlay to blend
+    int box_x1, box_y1;         ///< bottom right corner (exclusive) of that area
+
     int (*blend_row[4])(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a, int w,
                         ptrdiff_t alinesize);
     int (*blend_slice)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
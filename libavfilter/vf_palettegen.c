@@ -76,6 +76,9 @@ typedef struct PaletteGenContext {
     int nb_boxes;                           // number of boxes (increase will segmenting them)
     int palette_pushed;                     // if the palette frame is pushed into the outlink or not
     uint8_t transparency_color[4];          // background color for transparency
+    struct hist_node *slice_histograms;     // per slice hash tables, merged into histogram after each frame
+    int nb_slice_histograms;                // number of hash tables in slice_histograms
+    int *slice_ret;                         // per slice number of new colors or error code
 } PaletteGenContext;
 
 #define OFFSET(x) offsetof(PaletteGenContext, x)
@@ -403,9 +406,9 @@ static inline unsigned color_hash(uint32_t color)
 }
 
 /**
- * Locate the color in the hash table and increment its counter.
+ * Locate the color in the hash table and add count to its counter.
  */
-static int color_inc(struct hist_node *hist, uint32_t color)
+static int color_inc(struct hist_node *hist, uint32_t color, uint64_t count)
 {
     int i;
     const unsigned hash = color_hash(color);
@@ -415,7 +418,7 @@ static int color_inc(struct hist_node *hist, uint32_t color)
     for (i = 0; i < node->nb_entries; i++) {
         e = &node->entries[i];
         if (e->color == color) {
-            e->count++;
+            e->count += count;
             return 0;
         }
     }
@@ -425,26 +428,44 @@ static int color_inc(struct hist_node *hist, uint32_t color)
     if (!e)
         return AVERROR(ENOMEM);
     e->color = color;
-    e->count = 1;
+    e->count = count;
     return 1;
 }
 
+typedef struct ThreadData {
+    const AVFrame *f1, *f2;
+} ThreadData;
+
+/**
+ * Return the hash table a slice counts its colors into: the main histogram
+ * when not threading, a table of its own otherwise.
+ */
+static struct hist_node *get_slice_histogram(PaletteGenContext *s, int jobnr, int nb_jobs)
+{
+    return nb_jobs > 1 ? s->slice_histograms + jobnr * HIST_SIZE : s->histogram;
+}
+
 /**
  * Update histogram when pixels differ from previous frame.
  */
-static int update_histogram_diff(struct hist_node *hist,
-                                 const AVFrame *f1, const AVFrame *f2)
+static int update_histogram_diff(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    PaletteGenContext *s = ctx->priv;
+    struct hist_node *hist = get_slice_histogram(s, jobnr, nb_jobs);
+    const ThreadData *td = arg;
+    const AVFrame *f1 = td->f1, *f2 = td->f2;
+    const int slice_start = (f1->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (f1->height * (jobnr + 1)) / nb_jobs;
     int x, y, ret, nb_diff_colors = 0;
 
-    for (y = 0; y < f1->height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         const uint32_t *p = (const uint32_t *)(f1->data[0] + y*f1->linesize[0]);
         const uint32_t *q = (const uint32_t *)(f2->data[0] + y*f2->linesize[0]);
 
         for (x = 0; x < f1->width; x++) {
             if (p[x] == q[x])
                 continue;
-            ret = color_inc(hist, p[x]);
+            ret = color_inc(hist, p[x], 1);
             if (ret < 0)
                 return ret;
             nb_diff_colors += ret;
@@ -456,15 +477,21 @@ static int update_histogram_diff(struct hist_node *hist,
 /**
  * Simple histogram of the frame.
  */
-static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
+static int update_histogram_frame(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    PaletteGenContext *s = ctx->priv;
+    struct hist_node *hist = get_slice_histogram(s, jobnr, nb_jobs);
+    const ThreadData *td = arg;
+    const AVFrame *f = td->f1;
+    const int slice_start = (f->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (f->height * (jobnr + 1)) / nb_jobs;
     int x, y, ret, nb_diff_colors = 0;
 
-    for (y = 0; y < f->height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         const uint32_t *p = (const uint32_t *)(f->data[0] + y*f->linesize[0]);
 
         for (x = 0; x < f->width; x++) {
-            ret = color_inc(hist, p[x]);
+            ret = color_inc(hist, p[x], 1);
             if (ret < 0)
                 return ret;
             nb_diff_colors += ret;
@@ -473,6 +500,32 @@ static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
     return nb_diff_colors;
 }
 
+/**
+ * Add the slice histograms to the main one and empty them. The slices are
+ * merged in line order, so the colors end up in the same order as when
+ * counting the whole frame at once.
+ */
+static int merge_slice_histograms(PaletteGenContext *s, int nb_jobs)
+{
+    int i, j, k, ret, nb_new_colors = 0;
+
+    for (i = 0; i < HIST_SIZE; i++) {
+        for (j = 0; j < nb_jobs; j++) {
+            struct hist_node *node = &s->slice_histograms[j * HIST_SIZE + i];
+
+            for (k = 0; k < node->nb_entries; k++) {
+                ret = color_inc(s->histogram, node->entries[k].color, node->entries[k].count);
+                if (ret < 0)
+                    return ret;
+                nb_new_colors += ret;
+            }
+            av_freep(&node->entries);
+            node->nb_entries = 0;
+        }
+    }
+    return nb_new_colors;
+}
+
 /**
  * Update the histogram for each passing frame. No frame will be pushed here.
  */
@@ -480,18 +533,30 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
     PaletteGenContext *s = ctx->priv;
-    int ret = s->prev_frame ? update_histogram_diff(s->histogram, s->prev_frame, in)
-                            : update_histogram_frame(s->histogram, in);
-
-    if (ret > 0)
-        s->nb_refs += ret;
+    const int nb_jobs = FFMIN(in->height, ff_filter_get_nb_threads(ctx));
+    ThreadData td = { .f1 = s->prev_frame ? s->prev_frame : in, .f2 = in };
+    int i, ret = 0;
+
+    ctx->internal->execute(ctx, s->prev_frame ? update_histogram_diff : update_histogram_frame,
+                           &td, s->slice_ret, nb_jobs);
+    for (i = 0; i < nb_jobs; i++)
+        if (s->slice_ret[i] < 0)
+            ret = s->slice_ret[i];
+    if (nb_jobs > 1) {
+        int nb_new_colors = merge_slice_histograms(s, nb_jobs);
+        if (nb_new_colors < 0)
+            ret = nb_new_colors;
+        else
+            s->nb_refs += nb_new_colors;
+    } else if (ret >= 0) {
+        s->nb_refs += s->slice_ret[0];
+    }
 
     if (s->stats_mode == STATS_MODE_DIFF_FRAMES) {
         av_frame_free(&s->prev_frame);
         s->prev_frame = in;
     } else if (s->stats_mode == STATS_MODE_SINGLE_FRAMES) {
         AVFrame *out;
-        int i;
 
         out = get_palette_frame(ctx);
         out->pts = in->pts;
@@ -535,8 +600,22 @@ static int request_frame(AVFilterLink *outlink)
  */
 static int config_output(AVFilterLink *outlink)
 {
+    AVFilterContext *ctx = outlink->src;
+    PaletteGenContext *s = ctx->priv;
+
     outlink->w = outlink->h = 16;
     outlink->sample_aspect_ratio = av_make_q(1, 1);
+
+    s->slice_ret = av_calloc(ff_filter_get_nb_threads(ctx), sizeof(*s->slice_ret));
+    if (!s->slice_ret)
+        return AVERROR(ENOMEM);
+    if (ff_filter_get_nb_threads(ctx) > 1) {
+        s->slice_histograms = av_calloc(ff_filter_get_nb_threads(ctx) * HIST_SIZE,
+                                        sizeof(*s->slice_histograms));
+        if (!s->slice_histograms)
+            return AVERROR(ENOMEM);
+        s->nb_slice_histograms = ff_filter_get_nb_threads(ctx);
+    }
     return 0;
 }
 
@@ -547,7 +626,11 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     for (i = 0; i < HIST_SIZE; i++)
         av_freep(&s->histogram[i].entries);
+    for (i = 0; i < s->nb_slice_histograms * HIST_SIZE; i++)
+        av_freep(&s->slice_histograms[i].entries);
+    av_freep(&s->slice_histograms);
     av_freep(&s->refs);
+    av_freep(&s->slice_ret);
     av_frame_free(&s->prev_frame);
 }
 
@@ -579,4 +662,5 @@ AVFilter ff_vf_palettegen = {
     .inputs        = palettegen_inputs,
     .outputs       = palettegen_outputs,
     .priv_class    = &palettegen_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
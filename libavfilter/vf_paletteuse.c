@@ -77,13 +77,18 @@ struct cache_node {
 
 struct PaletteUseContext;
 
-typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
+typedef int (*set_frame_func)(struct PaletteUseContext *s, struct cache_node *cache,
+                              AVFrame *out, AVFrame *in,
                               int x_start, int y_start, int width, int height);
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFFrameSync fs;
-    struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    struct cache_node (*cache)[CACHE_SIZE]; /* lookup caches, one per slice */
+    int nb_caches;
+    int *slice_ret;
+    uint8_t *lut;                           /* optional RGB to palette index table */
+    int lut_bits;
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
     uint32_t palette[AVPALETTE_COUNT];
     int transparency_index; /* index in the palette of transparency. -1 if there is no transparency in the palette. */
@@ -120,6 +125,7 @@ static const AVOption paletteuse_options[] = {
         { "rectangle", "process smallest different rectangle", 0, AV_OPT_TYPE_CONST, {.i64=DIFF_MODE_RECTANGLE}, INT_MIN, INT_MAX, FLAGS, "diff_mode" },
     { "new", "take new palette for each output frame", OFFSET(new), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
     { "alpha_threshold", "set the alpha threshold for transparency", OFFSET(trans_thresh), AV_OPT_TYPE_INT, {.i64=128}, 0, 255 },
+    { "lut_bits", "set the bits per component of the color lookup table (0 to disable)", OFFSET(lut_bits), AV_OPT_TYPE_INT, {.i64=0}, 0, 6, FLAGS },
 
     /* following are the debug options, not part of the official API */
     { "debug_kdtree", "save Graphviz graph of the kdtree in specified file", OFFSET(dot_filename), AV_OPT_TYPE_STRING, {.str=NULL}, CHAR_MIN, CHAR_MAX, FLAGS },
@@ -338,7 +344,8 @@ end:
  * Note: a, r, g, and b are the components of color, but are passed as well to avoid
  * recomputing them (they are generally computed by the caller for other uses).
  */
-static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
+static av_always_inline int color_get(PaletteUseContext *s, struct cache_node *cache,
+                                      uint32_t color,
                                       uint8_t a, uint8_t r, uint8_t g, uint8_t b,
                                       const enum color_search_method search_method)
 {
@@ -348,7 +355,7 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
     const uint8_t ghash = g & ((1<<NBITS)-1);
     const uint8_t bhash = b & ((1<<NBITS)-1);
     const unsigned hash = rhash<<(NBITS*2) | ghash<<NBITS | bhash;
-    struct cache_node *node = &s->cache[hash];
+    struct cache_node *node = &cache[hash];
     struct cached_color *e;
 
     // first, check for transparency
@@ -356,6 +363,12 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
         return s->transparency_index;
     }
 
+    // the opacity is irrelevant to the search above the threshold
+    if (s->lut && a >= s->trans_thresh) {
+        const int bits = s->lut_bits, shift = 8 - bits;
+        return s->lut[(r >> shift) << (2*bits) | (g >> shift) << bits | b >> shift];
+    }
+
     for (i = 0; i < node->nb_entries; i++) {
         e = &node->entries[i];
         if (e->color == color)
@@ -372,7 +385,7 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
     return e->pal_entry;
 }
 
-static av_always_inline int get_dst_color_err(PaletteUseContext *s,
+static av_always_inline int get_dst_color_err(PaletteUseContext *s, struct cache_node *cache,
                                               uint32_t c, int *er, int *eg, int *eb,
                                               const enum color_search_method search_method)
 {
@@ -381,7 +394,7 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     const uint8_t g = c >>  8 & 0xff;
     const uint8_t b = c       & 0xff;
     uint32_t dstc;
-    const int dstx = color_get(s, c, a, r, g, b, search_method);
+    const int dstx = color_get(s, cache, c, a, r, g, b, search_method);
     if (dstx < 0)
         return dstx;
     dstc = s->palette[dstx];
@@ -391,7 +404,8 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     return dstx;
 }
 
-static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
+static av_always_inline int set_frame(PaletteUseContext *s, struct cache_node *cache,
+                                      AVFrame *out, AVFrame *in,
                                       int x_start, int y_start, int w, int h,
                                       enum dithering_mode dither,
                                       const enum color_search_method search_method)
@@ -418,7 +432,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t r = av_clip_uint8(r8 + d);
                 const uint8_t g = av_clip_uint8(g8 + d);
                 const uint8_t b = av_clip_uint8(b8 + d);
-                const int color = color_get(s, src[x], a8, r, g, b, search_method);
+                const int color = color_get(s, cache, src[x], a8, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -426,7 +440,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_HECKBERT) {
                 const int right = x < w - 1, down = y < h - 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -438,7 +452,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_FLOYD_STEINBERG) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -452,7 +466,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA2) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -471,7 +485,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_SIERRA2_4A) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -486,7 +500,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t r = src[x] >> 16 & 0xff;
                 const uint8_t g = src[x] >>  8 & 0xff;
                 const uint8_t b = src[x]       & 0xff;
-                const int color = color_get(s, src[x], a, r, g, b, search_method);
+                const int color = color_get(s, cache, src[x], a, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -894,6 +908,22 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int x, y, w, h;
+} ThreadData;
+
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int slice_start = td->y + (td->h *  jobnr     ) / nb_jobs;
+    const int slice_end   = td->y + (td->h * (jobnr + 1)) / nb_jobs;
+
+    return s->set_frame(s, s->cache[jobnr], td->out, td->in,
+                        td->x, slice_start, td->w, slice_end - slice_start);
+}
+
 static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
 {
     int x, y, w, h, ret;
@@ -926,7 +956,20 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    ret = s->set_frame(s, out, in, x, y, w, h);
+    if (s->dither == DITHERING_NONE || s->dither == DITHERING_BAYER) {
+        /* no error diffusion, so the rows can be mapped independently */
+        ThreadData td = { .in = in, .out = out, .x = x, .y = y, .w = w, .h = h };
+        const int nb_jobs = FFMAX(FFMIN(h, s->nb_caches), 1);
+        int i;
+
+        ret = 0;
+        ctx->internal->execute(ctx, set_frame_slice, &td, s->slice_ret, nb_jobs);
+        for (i = 0; i < nb_jobs; i++)
+            if (s->slice_ret[i] < 0)
+                ret = s->slice_ret[i];
+    } else {
+        ret = s->set_frame(s, s->cache[0], out, in, x, y, w, h);
+    }
     if (ret < 0) {
         av_frame_free(&out);
         *outf = NULL;
@@ -956,6 +999,12 @@ static int config_output(AVFilterLink *outlink)
     outlink->w = ctx->inputs[0]->w;
     outlink->h = ctx->inputs[0]->h;
 
+    s->nb_caches = ff_filter_get_nb_threads(ctx);
+    s->cache     = av_calloc(s->nb_caches, sizeof(*s->cache));
+    s->slice_ret = av_calloc(s->nb_caches, sizeof(*s->slice_ret));
+    if (!s->cache || !s->slice_ret)
+        return AVERROR(ENOMEM);
+
     outlink->time_base = ctx->inputs[0]->time_base;
     if ((ret = ff_framesync_configure(&s->fs)) < 0)
         return ret;
@@ -977,8 +1026,58 @@ static int config_input_palette(AVFilterLink *inlink)
     return 0;
 }
 
-static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
+static void free_caches(PaletteUseContext *s)
 {
+    int i, j;
+
+    for (j = 0; j < s->nb_caches; j++) {
+        for (i = 0; i < CACHE_SIZE; i++)
+            av_freep(&s->cache[j][i].entries);
+        memset(s->cache[j], 0, sizeof(s->cache[j]));
+    }
+}
+
+#define DEFINE_FILL_LUT(name, search)                                                   \
+static int fill_lut_##name(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)     \
+{                                                                                       \
+    PaletteUseContext *s = ctx->priv;                                                   \
+    const int bits = s->lut_bits, shift = 8 - bits;                                     \
+    const int size = 1 << bits;                                                         \
+    const int r_start = (size *  jobnr     ) / nb_jobs;                                 \
+    const int r_end   = (size * (jobnr + 1)) / nb_jobs;                                 \
+    int r, g, b;                                                                        \
+                                                                                        \
+    for (r = r_start; r < r_end; r++) {                                                 \
+        for (g = 0; g < size; g++) {                                                    \
+            for (b = 0; b < size; b++) {                                                \
+                /* search the center of the quantization cell */                        \
+                const uint8_t argb[] = {                                                \
+                    0xff,                                                               \
+                    r << shift | (1 << shift) >> 1,                                     \
+                    g << shift | (1 << shift) >> 1,                                     \
+                    b << shift | (1 << shift) >> 1,                                     \
+                };                                                                      \
+                s->lut[r << (2*bits) | g << bits | b] =                                 \
+                    COLORMAP_NEAREST(search, s->palette, s->map, argb, s->trans_thresh); \
+            }                                                                           \
+        }                                                                               \
+    }                                                                                   \
+    return 0;                                                                           \
+}
+
+DEFINE_FILL_LUT(nns_iterative, COLOR_SEARCH_NNS_ITERATIVE)
+DEFINE_FILL_LUT(nns_recursive, COLOR_SEARCH_NNS_RECURSIVE)
+DEFINE_FILL_LUT(bruteforce,    COLOR_SEARCH_BRUTEFORCE)
+
+static avfilter_action_func * const fill_lut_funcs[NB_COLOR_SEARCHES] = {
+    fill_lut_nns_iterative,
+    fill_lut_nns_recursive,
+    fill_lut_bruteforce,
+};
+
+static void load_palette(AVFilterContext *ctx, const AVFrame *palette_frame)
+{
+    PaletteUseContext *s = ctx->priv;
     int i, x, y;
     const uint32_t *p = (const uint32_t *)palette_frame->data[0];
     const int p_linesize = palette_frame->linesize[0] >> 2;
@@ -988,9 +1087,7 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
     if (s->new) {
         memset(s->palette, 0, sizeof(s->palette));
         memset(s->map, 0, sizeof(s->map));
-        for (i = 0; i < CACHE_SIZE; i++)
-            av_freep(&s->cache[i].entries);
-        memset(s->cache, 0, sizeof(s->cache));
+        free_caches(s);
     }
 
     i = 0;
@@ -1007,6 +1104,10 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
 
     load_colormap(s);
 
+    if (s->lut)
+        ctx->internal->execute(ctx, fill_lut_funcs[s->color_search_method], NULL, NULL,
+                               FFMIN(1 << s->lut_bits, ff_filter_get_nb_threads(ctx)));
+
     if (!s->new)
         s->palette_loaded = 1;
 }
@@ -1028,7 +1129,7 @@ static int load_apply_palette(FFFrameSync *fs)
         goto error;
     }
     if (!s->palette_loaded) {
-        load_palette(s, second);
+        load_palette(ctx, second);
     }
     ret = apply_palette(inlink, master, &out);
     if (ret < 0)
@@ -1041,10 +1142,12 @@ error:
 }
 
 #define DEFINE_SET_FRAME(color_search, name, value)                             \
-static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
+static int set_frame_##name(PaletteUseContext *s, struct cache_node *cache,     \
+                            AVFrame *out, AVFrame *in,                          \
                             int x_start, int y_start, int w, int h)             \
 {                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value, color_search);  \
+    return set_frame(s, cache, out, in, x_start, y_start, w, h,                 \
+                     value, color_search);                                      \
 }
 
 #define DEFINE_SET_FRAME_COLOR_SEARCH(color_search, color_search_macro)                                 \
@@ -1096,6 +1199,12 @@ static av_cold int init(AVFilterContext *ctx)
             s->ordered_dither[i] = (dither_value(i) >> s->bayer_scale) - delta;
     }
 
+    if (s->lut_bits) {
+        s->lut = av_malloc(1 << (3 * s->lut_bits));
+        if (!s->lut)
+            return AVERROR(ENOMEM);
+    }
+
     return 0;
 }
 
@@ -1107,12 +1216,14 @@ static int activate(AVFilterContext *ctx)
 
 static av_cold void uninit(AVFilterContext *ctx)
 {
-    int i;
     PaletteUseContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
-    for (i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
+    if (s->cache)
+        free_caches(s);
+    av_freep(&s->cache);
+    av_freep(&s->slice_ret);
+    av_freep(&s->lut);
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
 }
@@ -1149,4 +1260,5 @@ AVFilter ff_vf_paletteuse = {
     .inputs        = paletteuse_inputs,
     .outputs       = paletteuse_outputs,
     .priv_class    = &paletteuse_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
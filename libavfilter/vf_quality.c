@@ -0,0 +1,410 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Compute PSNR, SSIM and VMAF motion of two input videos in a single pass.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "avfilter.h"
+#include "formats.h"
+#include "framesync.h"
+#include "internal.h"
+#include "psnr.h"
+#include "ssim.h"
+#include "vmaf_motion.h"
+#include "video.h"
+
+typedef struct QualityContext {
+    const AVClass *class;
+    FFFrameSync fs;
+    int do_psnr;
+    int do_ssim;
+    int do_vmafmotion;
+
+    int nb_threads;
+    int nb_components;
+    int max, average_max;
+    int planewidth[4];
+    int planeheight[4];
+    double planeweight[4];
+    char comps[4];
+    uint64_t nb_frames;
+
+    PSNRDSPContext psnr_dsp;
+    uint64_t (*sse)[4];
+    double mse, min_mse, max_mse, mse_comp[4];
+
+    SSIMDSPContext ssim_dsp;
+    void **temp;
+    float *line_ssim[4];
+    double ssim_total, ssim_comp[4];
+
+    VMAFMotionData vmaf;
+    uint64_t *sad;
+} QualityContext;
+
+#define OFFSET(x) offsetof(QualityContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
+
+static const AVOption quality_options[] = {
+    { "psnr",       "compute PSNR",        OFFSET(do_psnr),       AV_OPT_TYPE_BOOL, {.i64=1}, 0, 1, FLAGS },
+    { "ssim",       "compute SSIM",        OFFSET(do_ssim),       AV_OPT_TYPE_BOOL, {.i64=1}, 0, 1, FLAGS },
+    { "vmafmotion", "compute VMAF motion", OFFSET(do_vmafmotion), AV_OPT_TYPE_BOOL, {.i64=1}, 0, 1, FLAGS },
+    { NULL }
+};
+
+FRAMESYNC_DEFINE_CLASS(quality, QualityContext, fs);
+
+typedef struct ThreadData {
+    AVFrame *main, *ref;
+} ThreadData;
+
+static int quality_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    QualityContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int c, y;
+
+    for (c = 0; c < s->nb_components; c++) {
+        const int w = s->planewidth[c];
+        const int h = s->planeheight[c];
+        const int main_linesize = td->main->linesize[c];
+        const int ref_linesize  = td->ref->linesize[c];
+
+        if (s->do_psnr) {
+            const int slice_start = (h *  jobnr     ) / nb_jobs;
+            const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+            const uint8_t *main_line = td->main->data[c] + main_linesize * slice_start;
+            const uint8_t *ref_line  = td->ref->data[c]  + ref_linesize  * slice_start;
+            uint64_t m = 0;
+
+            for (y = slice_start; y < slice_end; y++) {
+                m += s->psnr_dsp.sse_line(main_line, ref_line, w);
+                main_line += main_linesize;
+                ref_line  += ref_linesize;
+            }
+            s->sse[jobnr][c] = m;
+        }
+
+        if (s->do_ssim) {
+            const int lines = (h >> 2) - 1;
+            const int y_start = 1 + (lines *  jobnr     ) / nb_jobs;
+            const int y_end   = 1 + (lines * (jobnr + 1)) / nb_jobs;
+
+            ff_ssim_plane(&s->ssim_dsp, td->main->data[c], main_linesize,
+                          td->ref->data[c], ref_linesize, w, h,
+                          s->temp[jobnr], s->max, s->line_ssim[c], y_start, y_end);
+        }
+    }
+
+    if (s->do_vmafmotion) {
+        const int slice_start = (s->vmaf.height *  jobnr     ) / nb_jobs;
+        const int slice_end   = (s->vmaf.height * (jobnr + 1)) / nb_jobs;
+
+        s->sad[jobnr] = ff_vmafmotion_process_slice(&s->vmaf, td->ref->data[0], td->ref->linesize[0],
+                                                    slice_start, slice_end);
+    }
+
+    return 0;
+}
+
+static int do_quality(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    QualityContext *s = ctx->priv;
+    AVFrame *master, *ref;
+    AVDictionary **metadata;
+    ThreadData td;
+    int ret, c, j, nb_jobs;
+
+    ret = ff_framesync_dualinput_get(fs, &master, &ref);
+    if (ret < 0)
+        return ret;
+    if (!ref)
+        return ff_filter_frame(ctx->outputs[0], master);
+    metadata = &master->metadata;
+
+    td.main = master;
+    td.ref  = ref;
+    nb_jobs = FFMIN(s->planeheight[1], s->nb_threads);
+    ctx->internal->execute(ctx, quality_slice, &td, NULL, nb_jobs);
+
+    if (s->do_psnr) {
+        double comp_mse[4], mse = 0;
+
+        for (c = 0; c < s->nb_components; c++) {
+            uint64_t sum = 0;
+
+            for (j = 0; j < nb_jobs; j++)
+                sum += s->sse[j][c];
+            comp_mse[c] = sum / (double)(s->planewidth[c] * s->planeheight[c]);
+            mse += comp_mse[c] * s->planeweight[c];
+            s->mse_comp[c] += comp_mse[c];
+            ff_psnr_set_meta(metadata, "lavfi.psnr.mse.",  s->comps[c], comp_mse[c]);
+            ff_psnr_set_meta(metadata, "lavfi.psnr.psnr.", s->comps[c], ff_psnr_get(comp_mse[c], 1, s->max));
+        }
+        s->min_mse = FFMIN(s->min_mse, mse);
+        s->max_mse = FFMAX(s->max_mse, mse);
+        s->mse += mse;
+
+        ff_psnr_set_meta(metadata, "lavfi.psnr.mse_avg",  0, mse);
+        ff_psnr_set_meta(metadata, "lavfi.psnr.psnr_avg", 0, ff_psnr_get(mse, 1, s->average_max));
+    }
+
+    if (s->do_ssim) {
+        float ssimv = 0.0;
+
+        for (c = 0; c < s->nb_components; c++) {
+            float ssim = ff_ssim_plane_end(s->line_ssim[c], s->planewidth[c], s->planeheight[c]);
+
+            ssimv += s->planeweight[c] * ssim;
+            s->ssim_comp[c] += ssim;
+            ff_psnr_set_meta(metadata, "lavfi.ssim.", av_toupper(s->comps[c]), ssim);
+        }
+        s->ssim_total += ssimv;
+
+        ff_psnr_set_meta(metadata, "lavfi.ssim.All", 0, ssimv);
+        ff_psnr_set_meta(metadata, "lavfi.ssim.dB",  0, ff_ssim_db(ssimv, 1.0));
+    }
+
+    if (s->do_vmafmotion) {
+        uint64_t sad = 0;
+
+        for (j = 0; j < nb_jobs; j++)
+            sad += s->sad[j];
+        ff_psnr_set_meta(metadata, "lavfi.vmafmotion.score", 0, ff_vmafmotion_end_frame(&s->vmaf, sad));
+    }
+
+    s->nb_frames++;
+
+    return ff_filter_frame(ctx->outputs[0], master);
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    QualityContext *s = ctx->priv;
+
+    s->min_mse = +INFINITY;
+    s->max_mse = -INFINITY;
+
+    s->fs.on_event = do_quality;
+    return 0;
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY10,
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P,
+        AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P, AV_PIX_FMT_YUVJ444P,
+        AV_PIX_FMT_YUV420P10, AV_PIX_FMT_YUV422P10, AV_PIX_FMT_YUV444P10,
+        AV_PIX_FMT_NONE
+    };
+
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_input_ref(AVFilterLink *inlink)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    AVFilterContext *ctx = inlink->dst;
+    QualityContext *s = ctx->priv;
+    double average_max = 0;
+    unsigned sum = 0;
+    int i;
+
+    if (ctx->inputs[0]->w != ctx->inputs[1]->w ||
+        ctx->inputs[0]->h != ctx->inputs[1]->h) {
+        av_log(ctx, AV_LOG_ERROR, "Width and height of input videos must be same.\n");
+        return AVERROR(EINVAL);
+    }
+    if (ctx->inputs[0]->format != ctx->inputs[1]->format) {
+        av_log(ctx, AV_LOG_ERROR, "Inputs must be of same pixel format.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->nb_components = desc->nb_components;
+    s->max = (1 << desc->comp[0].depth) - 1;
+    s->comps[0] = 'y';
+    s->comps[1] = 'u';
+    s->comps[2] = 'v';
+
+    s->planeheight[1] = s->planeheight[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
+    s->planeheight[0] = inlink->h;
+    s->planewidth[1]  = s->planewidth[2]  = AV_CEIL_RSHIFT(inlink->w, desc->log2_chroma_w);
+    s->planewidth[0]  = inlink->w;
+    for (i = 0; i < s->nb_components; i++)
+        sum += s->planeheight[i] * s->planewidth[i];
+    for (i = 0; i < s->nb_components; i++) {
+        s->planeweight[i] = (double) s->planeheight[i] * s->planewidth[i] / sum;
+        average_max += s->max * s->planeweight[i];
+    }
+    s->average_max = lrint(average_max);
+
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+
+    if (s->do_psnr) {
+        ff_psnr_init(&s->psnr_dsp, desc->comp[0].depth);
+        s->sse = av_calloc(s->nb_threads, sizeof(*s->sse));
+        if (!s->sse)
+            return AVERROR(ENOMEM);
+    }
+
+    if (s->do_ssim) {
+        ff_ssim_init(&s->ssim_dsp);
+        s->temp = av_calloc(s->nb_threads, sizeof(*s->temp));
+        if (!s->temp)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < s->nb_threads; i++) {
+            s->temp[i] = av_malloc(SSIM_TEMP_SIZE(inlink->w));
+            if (!s->temp[i])
+                return AVERROR(ENOMEM);
+        }
+        for (i = 0; i < s->nb_components; i++) {
+            s->line_ssim[i] = av_malloc_array(FFMAX(s->planeheight[i] >> 2, 1), sizeof(*s->line_ssim[i]));
+            if (!s->line_ssim[i])
+                return AVERROR(ENOMEM);
+        }
+    }
+
+    if (s->do_vmafmotion) {
+        s->sad = av_calloc(s->nb_threads, sizeof(*s->sad));
+        if (!s->sad)
+            return AVERROR(ENOMEM);
+        return ff_vmafmotion_init(&s->vmaf, inlink->w, inlink->h, inlink->format);
+    }
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    QualityContext *s = ctx->priv;
+    AVFilterLink *mainlink = ctx->inputs[0];
+    int ret;
+
+    ret = ff_framesync_init_dualinput(&s->fs, ctx);
+    if (ret < 0)
+        return ret;
+    outlink->w = mainlink->w;
+    outlink->h = mainlink->h;
+    outlink->time_base = mainlink->time_base;
+    outlink->sample_aspect_ratio = mainlink->sample_aspect_ratio;
+    outlink->frame_rate = mainlink->frame_rate;
+    if ((ret = ff_framesync_configure(&s->fs)) < 0)
+        return ret;
+
+    return 0;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    QualityContext *s = ctx->priv;
+    return ff_framesync_activate(&s->fs);
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    QualityContext *s = ctx->priv;
+    char buf[256];
+    int i;
+
+    if (s->nb_frames > 0 && s->do_psnr) {
+        buf[0] = 0;
+        for (i = 0; i < s->nb_components; i++)
+            av_strlcatf(buf, sizeof(buf), " %c:%f", s->comps[i],
+                        ff_psnr_get(s->mse_comp[i], s->nb_frames, s->max));
+        av_log(ctx, AV_LOG_INFO, "PSNR%s average:%f min:%f max:%f\n",
+               buf,
+               ff_psnr_get(s->mse, s->nb_frames, s->average_max),
+               ff_psnr_get(s->max_mse, 1, s->average_max),
+               ff_psnr_get(s->min_mse, 1, s->average_max));
+    }
+
+    if (s->nb_frames > 0 && s->do_ssim) {
+        buf[0] = 0;
+        for (i = 0; i < s->nb_components; i++)
+            av_strlcatf(buf, sizeof(buf), " %c:%f (%f)", av_toupper(s->comps[i]),
+                        s->ssim_comp[i] / s->nb_frames,
+                        ff_ssim_db(s->ssim_comp[i], s->nb_frames));
+        av_log(ctx, AV_LOG_INFO, "SSIM%s All:%f (%f)\n", buf,
+               s->ssim_total / s->nb_frames, ff_ssim_db(s->ssim_total, s->nb_frames));
+    }
+
+    if (s->do_vmafmotion) {
+        double avg_motion = ff_vmafmotion_uninit(&s->vmaf);
+
+        if (s->nb_frames > 0)
+            av_log(ctx, AV_LOG_INFO, "VMAF Motion avg: %.3f\n", avg_motion);
+    }
+
+    ff_framesync_uninit(&s->fs);
+    av_freep(&s->sse);
+    if (s->temp) {
+        for (i = 0; i < s->nb_threads; i++)
+            av_freep(&s->temp[i]);
+    }
+    av_freep(&s->temp);
+    for (i = 0; i < 4; i++)
+        av_freep(&s->line_ssim[i]);
+    av_freep(&s->sad);
+}
+
+static const AVFilterPad quality_inputs[] = {
+    {
+        .name         = "main",
+        .type         = AVMEDIA_TYPE_VIDEO,
+    },{
+        .name         = "reference",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input_ref,
+    },
+    { NULL }
+};
+
+static const AVFilterPad quality_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_quality = {
+    .name          = "quality",
+    .description   = NULL_IF_CONFIG_SMALL("Calculate the PSNR, SSIM and VMAF motion between two video streams."),
+    .preinit       = quality_framesync_preinit,
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .activate      = activate,
+    .priv_size     = sizeof(QualityContext),
+    .priv_class    = &quality_class,
+    .inputs        = quality_inputs,
+    .outputs       = quality_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
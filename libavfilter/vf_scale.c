@@ -299,6 +299,11 @@ static int config_props(AVFilterLink *outlink)
             av_opt_set_int(*s, "sws_flags", scale->flags, 0);
             av_opt_set_int(*s, "param0", scale->param[0], 0);
             av_opt_set_int(*s, "param1", scale->param[1], 0);
+            /* Only the progressive context scales whole frames. The scaler
+             * starts its own threads, so they are only used when the threads
+             * option was set on this filter. */
+            if (i == 0 && ctx->nb_threads > 0)
+                av_opt_set_int(*s, "threads", ff_filter_get_nb_threads(ctx), 0);
             if (scale->in_range != AVCOL_RANGE_UNSPECIFIED)
                 av_opt_set_int(*s, "src_range",
                                scale->in_range == AVCOL_RANGE_JPEG, 0);
@@ -407,7 +412,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     AVFrame *out;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
     char buf[32];
-    int in_range;
+    int in_range, ret;
 
     if (in->colorspace == AVCOL_SPC_YCGCO)
         av_log(link->dst, AV_LOG_WARNING, "Detected unsupported YCgCo colorspace.\n");
@@ -416,8 +421,6 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
        || in->height != link->h
        || in->format != link->format
        || in->sample_aspect_ratio.den != link->sample_aspect_ratio.den || in->sample_aspect_ratio.num != link->sample_aspect_ratio.num) {
-        int ret;
-
         if (scale->eval_mode == EVAL_MODE_INIT) {
             snprintf(buf, sizeof(buf)-1, "%d", outlink->w);
             av_opt_set(scale, "w", buf, 0);
@@ -517,7 +520,12 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
             scale_slice(link, out, in, scale->sws, slice_start, slice_h, 1, 0);
         }
     }else{
-        scale_slice(link, out, in, scale->sws, 0, link->h, 1, 0);
+        ret = sws_scale_frame(scale->sws, out, in);
+        if (ret < 0) {
+            av_frame_free(&in);
+            av_frame_free(&out);
+            return ret;
+        }
     }
 
     av_frame_free(&in);
@@ -36,8 +36,10 @@ typedef struct SPPContext {
     int mode;
     int qscale_type;
     int temp_linesize;
+    int temp_size;              ///< number of elements in each job's temp buffer
     uint8_t *src;
-    uint16_t *temp;
+    uint16_t *temp;             ///< one accumulation buffer per job
+    int nb_threads;
     AVCodecContext *avctx;
     AVDCT *dct;
     int8_t *non_b_qp_table;
@@ -59,13 +59,10 @@ typedef struct SSIMContext {
     uint8_t rgba_map[4];
     int planewidth[4];
     int planeheight[4];
-    int *temp;
+    int nb_threads;
+    void **temp;
+    float *line_ssim[4];
     int is_rgb;
-    float (*ssim_plane)(SSIMDSPContext *dsp,
-                        uint8_t *main, int main_stride,
-                        uint8_t *ref, int ref_stride,
-                        int width, int height, void *temp,
-                        int max);
     SSIMDSPContext dsp;
 } SSIMContext;
 
@@ -221,21 +218,19 @@ static float ssim_endn_8bit(const int (*sum0)[4], const int (*sum1)[4], int widt
 
 #define SUM_LEN(w) (((w) >> 2) + 3)
 
-static float ssim_plane_16bit(SSIMDSPContext *dsp,
-                              uint8_t *main, int main_stride,
-                              uint8_t *ref, int ref_stride,
-                              int width, int height, void *temp,
-                              int max)
+static void ssim_plane_16bit(SSIMDSPContext *dsp,
+                             uint8_t *main, int main_stride,
+                             uint8_t *ref, int ref_stride,
+                             int width, int height, void *temp,
+                             int max, float *line_ssim, int y_start, int y_end)
 {
-    int z = 0, y;
-    float ssim = 0.0;
+    int z = y_start - 1, y;
     int64_t (*sum0)[4] = temp;
     int64_t (*sum1)[4] = sum0 + SUM_LEN(width);
 
     width >>= 2;
-    height >>= 2;
 
-    for (y = 1; y < height; y++) {
+    for (y = y_start; y < y_end; y++) {
         for (; z <= y; z++) {
             FFSWAP(void*, sum0, sum1);
             ssim_4x4xn_16bit(&main[4 * z * main_stride], main_stride,
@@ -243,27 +238,23 @@ static float ssim_plane_16bit(SSIMDSPContext *dsp,
                              sum0, width);
         }
 
-        ssim += ssim_endn_16bit((const int64_t (*)[4])sum0, (const int64_t (*)[4])sum1, width - 1, max);
+        line_ssim[y] = ssim_endn_16bit((const int64_t (*)[4])sum0, (const int64_t (*)[4])sum1, width - 1, max);
     }
-
-    return ssim / ((height - 1) * (width - 1));
 }
 
-static float ssim_plane(SSIMDSPContext *dsp,
-                        uint8_t *main, int main_stride,
-                        uint8_t *ref, int ref_stride,
-                        int width, int height, void *temp,
-                        int max)
+static void ssim_plane_8bit(SSIMDSPContext *dsp,
+                            uint8_t *main, int main_stride,
+                            uint8_t *ref, int ref_stride,
+                            int width, int height, void *temp,
+                            int max, float *line_ssim, int y_start, int y_end)
 {
-    int z = 0, y;
-    float ssim = 0.0;
+    int z = y_start - 1, y;
     int (*sum0)[4] = temp;
     int (*sum1)[4] = sum0 + SUM_LEN(width);
 
     width >>= 2;
-    height >>= 2;
 
-    for (y = 1; y < height; y++) {
+    for (y = y_start; y < y_end; y++) {
         for (; z <= y; z++) {
             FFSWAP(void*, sum0, sum1);
             dsp->ssim_4x4_line(&main[4 * z * main_stride], main_stride,
@@ -271,17 +262,75 @@ static float ssim_plane(SSIMDSPContext *dsp,
                                sum0, width);
         }
 
-        ssim += dsp->ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1, width - 1);
+        line_ssim[y] = dsp->ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1, width - 1);
     }
+}
+
+void ff_ssim_plane(SSIMDSPContext *dsp,
+                   uint8_t *main, int main_stride,
+                   uint8_t *ref, int ref_stride,
+                   int width, int height, void *temp,
+                   int max, float *line_ssim, int y_start, int y_end)
+{
+    if (max > 255)
+        ssim_plane_16bit(dsp, main, main_stride, ref, ref_stride,
+                         width, height, temp, max, line_ssim, y_start, y_end);
+    else
+        ssim_plane_8bit(dsp, main, main_stride, ref, ref_stride,
+                        width, height, temp, max, line_ssim, y_start, y_end);
+}
+
+float ff_ssim_plane_end(const float *line_ssim, int width, int height)
+{
+    float ssim = 0.0;
+    int y;
+
+    width  >>= 2;
+    height >>= 2;
+
+    for (y = 1; y < height; y++)
+        ssim += line_ssim[y];
 
     return ssim / ((height - 1) * (width - 1));
 }
 
-static double ssim_db(double ssim, double weight)
+double ff_ssim_db(double ssim, double weight)
 {
     return 10 * log10(weight / (weight - ssim));
 }
 
+void ff_ssim_init(SSIMDSPContext *dsp)
+{
+    dsp->ssim_4x4_line = ssim_4x4xn_8bit;
+    dsp->ssim_end_line = ssim_endn_8bit;
+    if (ARCH_X86)
+        ff_ssim_init_x86(dsp);
+}
+
+typedef struct ThreadData {
+    AVFrame *main, *ref;
+} ThreadData;
+
+static int ssim_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    SSIMContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int i;
+
+    for (i = 0; i < s->nb_components; i++) {
+        const int lines = (s->planeheight[i] >> 2) - 1;
+        const int y_start = 1 + (lines *  jobnr     ) / nb_jobs;
+        const int y_end   = 1 + (lines * (jobnr + 1)) / nb_jobs;
+
+        ff_ssim_plane(&s->dsp, td->main->data[i], td->main->linesize[i],
+                      td->ref->data[i], td->ref->linesize[i],
+                      s->planewidth[i], s->planeheight[i],
+                      s->temp[jobnr], s->max, s->line_ssim[i], y_start, y_end);
+    }
+
+    return 0;
+}
+
 static int do_ssim(FFFrameSync *fs)
 {
     AVFilterContext *ctx = fs->parent;
@@ -289,7 +338,8 @@ static int do_ssim(FFFrameSync *fs)
     AVFrame *master, *ref;
     AVDictionary **metadata;
     float c[4], ssimv = 0.0;
-    int ret, i;
+    ThreadData td;
+    int ret, i, nb_jobs;
 
     ret = ff_framesync_dualinput_get(fs, &master, &ref);
     if (ret < 0)
@@ -300,11 +350,13 @@ static int do_ssim(FFFrameSync *fs)
 
     s->nb_frames++;
 
+    td.main = master;
+    td.ref  = ref;
+    nb_jobs = av_clip(s->planeheight[1] / 4 - 1, 1, s->nb_threads);
+    ctx->internal->execute(ctx, ssim_slice, &td, NULL, nb_jobs);
+
     for (i = 0; i < s->nb_components; i++) {
-        c[i] = s->ssim_plane(&s->dsp, master->data[i], master->linesize[i],
-                             ref->data[i], ref->linesize[i],
-                             s->planewidth[i], s->planeheight[i], s->temp,
-                             s->max);
+        c[i] = ff_ssim_plane_end(s->line_ssim[i], s->planewidth[i], s->planeheight[i]);
         ssimv += s->coefs[i] * c[i];
         s->ssim[i] += c[i];
     }
@@ -315,7 +367,7 @@ static int do_ssim(FFFrameSync *fs)
     s->ssim_total += ssimv;
 
     set_meta(metadata, "lavfi.ssim.All", 0, ssimv);
-    set_meta(metadata, "lavfi.ssim.dB", 0, ssim_db(ssimv, 1.0));
+    set_meta(metadata, "lavfi.ssim.dB", 0, ff_ssim_db(ssimv, 1.0));
 
     if (s->stats_file) {
         fprintf(s->stats_file, "n:%"PRId64" ", s->nb_frames);
@@ -325,7 +377,7 @@ static int do_ssim(FFFrameSync *fs)
             fprintf(s->stats_file, "%c:%f ", s->comps[i], c[cidx]);
         }
 
-        fprintf(s->stats_file, "All:%f (%f)\n", ssimv, ssim_db(ssimv, 1.0));
+        fprintf(s->stats_file, "All:%f (%f)\n", ssimv, ff_ssim_db(ssimv, 1.0));
     }
 
     return ff_filter_frame(ctx->outputs[0], master);
@@ -410,16 +462,23 @@ static int config_input_ref(AVFilterLink *inlink)
     for (i = 0; i < s->nb_components; i++)
         s->coefs[i] = (double) s->planeheight[i] * s->planewidth[i] / sum;
 
-    s->temp = av_mallocz_array(2 * SUM_LEN(inlink->w), (desc->comp[0].depth > 8) ? sizeof(int64_t[4]) : sizeof(int[4]));
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->temp  = av_calloc(s->nb_threads, sizeof(*s->temp));
     if (!s->temp)
         return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_threads; i++) {
+        s->temp[i] = av_mallocz_array(2 * SUM_LEN(inlink->w), (desc->comp[0].depth > 8) ? sizeof(int64_t[4]) : sizeof(int[4]));
+        if (!s->temp[i])
+            return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < s->nb_components; i++) {
+        s->line_ssim[i] = av_malloc_array(FFMAX(s->planeheight[i] >> 2, 1), sizeof(*s->line_ssim[i]));
+        if (!s->line_ssim[i])
+            return AVERROR(ENOMEM);
+    }
     s->max = (1 << desc->comp[0].depth) - 1;
 
-    s->ssim_plane = desc->comp[0].depth > 8 ? ssim_plane_16bit : ssim_plane;
-    s->dsp.ssim_4x4_line = ssim_4x4xn_8bit;
-    s->dsp.ssim_end_line = ssim_endn_8bit;
-    if (ARCH_X86)
-        ff_ssim_init_x86(&s->dsp);
+    ff_ssim_init(&s->dsp);
 
     return 0;
 }
@@ -455,18 +514,18 @@ static int activate(AVFilterContext *ctx)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     SSIMContext *s = ctx->priv;
+    int i;
 
     if (s->nb_frames > 0) {
         char buf[256];
-        int i;
         buf[0] = 0;
         for (i = 0; i < s->nb_components; i++) {
             int c = s->is_rgb ? s->rgba_map[i] : i;
             av_strlcatf(buf, sizeof(buf), " %c:%f (%f)", s->comps[i], s->ssim[c] / s->nb_frames,
-                        ssim_db(s->ssim[c], s->nb_frames));
+                        ff_ssim_db(s->ssim[c], s->nb_frames));
         }
         av_log(ctx, AV_LOG_INFO, "SSIM%s All:%f (%f)\n", buf,
-               s->ssim_total / s->nb_frames, ssim_db(s->ssim_total, s->nb_frames));
+               s->ssim_total / s->nb_frames, ff_ssim_db(s->ssim_total, s->nb_frames));
     }
 
     ff_framesync_uninit(&s->fs);
@@ -474,7 +533,13 @@ static av_cold void uninit(AVFilterContext *ctx)
     if (s->stats_file && s->stats_file != stdout)
         fclose(s->stats_file);
 
+    if (s->temp) {
+        for (i = 0; i < s->nb_threads; i++)
+            av_freep(&s->temp[i]);
+    }
     av_freep(&s->temp);
+    for (i = 0; i < 4; i++)
+        av_freep(&s->line_ssim[i]);
 }
 
 static const AVFilterPad ssim_inputs[] = {
@@ -510,4 +575,5 @@ AVFilter ff_vf_ssim = {
     .priv_class    = &ssim_class,
     .inputs        = ssim_inputs,
     .outputs       = ssim_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -50,6 +50,9 @@ enum TonemapAlgorithm {
     TONEMAP_MAX,
 };
 
+/* Number of intervals of the curve lookup table. */
+#define LUT_SIZE 4096
+
 static const struct LumaCoefficients luma_coefficients[AVCOL_SPC_NB] = {
     [AVCOL_SPC_FCC]        = { 0.30,   0.59,   0.11   },
     [AVCOL_SPC_BT470BG]    = { 0.299,  0.587,  0.114  },
@@ -69,8 +72,22 @@ typedef struct TonemapContext {
     double peak;
 
     const struct LumaCoefficients *coeffs;
+
+    /* curve sampled at sig = lut_peak * (i / LUT_SIZE)^2, so that the dark
+     * range where most of the curvature is gets most of the entries */
+    float lut[LUT_SIZE + 1];
+    double lut_peak;
+    float lut_scale;
+    int use_lut;
 } TonemapContext;
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    const AVPixFmtDescriptor *desc;
+    double peak;
+    float hable_peak;
+} ThreadData;
+
 static const enum AVPixelFormat pix_fmts[] = {
     AV_PIX_FMT_GBRPF32,
     AV_PIX_FMT_GBRAPF32,
@@ -126,9 +143,75 @@ static float mobius(float in, float j, double peak)
     return (b * b + 2.0f * b * j + j * j) / (b - a) * (in + a) / (in + b);
 }
 
+static float tonemap_curve(const TonemapContext *s, float sig, double peak,
+                           float hable_peak)
+{
+    switch(s->tonemap) {
+    default:
+    case TONEMAP_NONE:
+        // do nothing
+        break;
+    case TONEMAP_LINEAR:
+        sig = sig * s->param / peak;
+        break;
+    case TONEMAP_GAMMA:
+        sig = sig > 0.05f ? pow(sig / peak, 1.0f / s->param)
+                          : sig * pow(0.05f / peak, 1.0f / s->param) / 0.05f;
+        break;
+    case TONEMAP_CLIP:
+        sig = av_clipf(sig * s->param, 0, 1.0f);
+        break;
+    case TONEMAP_HABLE:
+        sig = hable(sig) / hable_peak;
+        break;
+    case TONEMAP_REINHARD:
+        sig = sig / (sig + s->param) * (peak + s->param) / peak;
+        break;
+    case TONEMAP_MOBIUS:
+        sig = mobius(sig, s->param, peak);
+        break;
+    }
+
+    return sig;
+}
+
+static void build_lut(TonemapContext *s, double peak, float hable_peak)
+{
+    int i;
+
+    /* the rational curves are cheaper to evaluate than to look up */
+    s->use_lut = s->tonemap == TONEMAP_GAMMA || s->tonemap == TONEMAP_MOBIUS;
+    if (!s->use_lut || s->lut_peak == peak)
+        return;
+
+    for (i = 0; i <= LUT_SIZE; i++) {
+        double t = (double)i / LUT_SIZE;
+        s->lut[i] = tonemap_curve(s, peak * t * t, peak, hable_peak);
+    }
+    s->lut_peak  = peak;
+    s->lut_scale = 1.0 / peak;
+}
+
+static float lookup_curve(const TonemapContext *s, float sig, double peak,
+                          float hable_peak)
+{
+    float t;
+    int i;
+
+    /* values above the peak are rare, evaluate them exactly */
+    if (sig >= s->lut_peak)
+        return tonemap_curve(s, sig, peak, hable_peak);
+
+    t = sqrtf(sig * s->lut_scale) * LUT_SIZE;
+    i = FFMIN((int)t, LUT_SIZE - 1);
+    t -= i;
+    return s->lut[i] + (s->lut[i + 1] - s->lut[i]) * t;
+}
+
 #define MIX(x,y,a) (x) * (1 - (a)) + (y) * (a)
 static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
-                    const AVPixFmtDescriptor *desc, int x, int y, double peak)
+                    const AVPixFmtDescriptor *desc, int x, int y, double peak,
+                    float hable_peak)
 {
     const float *r_in = (const float *)(in->data[0] + x * desc->comp[0].step + y * in->linesize[0]);
     const float *b_in = (const float *)(in->data[1] + x * desc->comp[1].step + y * in->linesize[1]);
@@ -158,31 +241,10 @@ static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
     sig = FFMAX(FFMAX3(*r_out, *g_out, *b_out), 1e-6);
     sig_orig = sig;
 
-    switch(s->tonemap) {
-    default:
-    case TONEMAP_NONE:
-        // do nothing
-        break;
-    case TONEMAP_LINEAR:
-        sig = sig * s->param / peak;
-        break;
-    case TONEMAP_GAMMA:
-        sig = sig > 0.05f ? pow(sig / peak, 1.0f / s->param)
-                          : sig * pow(0.05f / peak, 1.0f / s->param) / 0.05f;
-        break;
-    case TONEMAP_CLIP:
-        sig = av_clipf(sig * s->param, 0, 1.0f);
-        break;
-    case TONEMAP_HABLE:
-        sig = hable(sig) / hable(peak);
-        break;
-    case TONEMAP_REINHARD:
-        sig = sig / (sig + s->param) * (peak + s->param) / peak;
-        break;
-    case TONEMAP_MOBIUS:
-        sig = mobius(sig, s->param, peak);
-        break;
-    }
+    if (s->use_lut)
+        sig = lookup_curve(s, sig, peak, hable_peak);
+    else
+        sig = tonemap_curve(s, sig, peak, hable_peak);
 
     /* apply the computed scale factor to the color,
      * linearly to prevent discoloration */
@@ -191,10 +253,29 @@ static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
     *b_out *= sig / sig_orig;
 }
 
+static int tonemap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    TonemapContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    AVFrame *in = td->in;
+    AVFrame *out = td->out;
+    const int slice_start = (out->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (out->height * (jobnr + 1)) / nb_jobs;
+    int x, y;
+
+    for (y = slice_start; y < slice_end; y++)
+        for (x = 0; x < out->width; x++)
+            tonemap(s, out, in, td->desc, x, y, td->peak, td->hable_peak);
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
-    TonemapContext *s = link->dst->priv;
-    AVFilterLink *outlink = link->dst->outputs[0];
+    AVFilterContext *ctx = link->dst;
+    TonemapContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    ThreadData td;
     AVFrame *out;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
     const AVPixFmtDescriptor *odesc = av_pix_fmt_desc_get(outlink->format);
@@ -245,9 +326,14 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     }
 
     /* do the tone map */
-    for (y = 0; y < out->height; y++)
-        for (x = 0; x < out->width; x++)
-            tonemap(s, out, in, desc, x, y, peak);
+    td.out        = out;
+    td.in         = in;
+    td.desc       = desc;
+    td.peak       = peak;
+    td.hable_peak = hable(peak);
+    build_lut(s, peak, td.hable_peak);
+    ctx->internal->execute(ctx, tonemap_slice, &td, NULL,
+                           FFMIN(out->height, ff_filter_get_nb_threads(ctx)));
 
     /* copy/generate alpha if needed */
     if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
@@ -321,4 +407,5 @@ AVFilter ff_vf_tonemap = {
     .priv_class      = &tonemap_class,
     .inputs          = tonemap_inputs,
     .outputs         = tonemap_outputs,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -47,10 +47,12 @@ typedef struct USPPContext {
     uint8_t *src[3];
     uint16_t *temp[3];
     int outbuf_size;
-    uint8_t *outbuf;
+    uint8_t *outbuf;            ///< one packet buffer per job
     AVCodecContext *avctx_enc[BLOCK*BLOCK];
-    AVFrame *frame;
-    AVFrame *frame_dec;
+    AVFrame *frame[BLOCK*BLOCK];
+    AVFrame *frame_dec[BLOCK*BLOCK];
+    int quality;
+    int nb_threads;
     uint8_t *non_b_qp_table;
     int non_b_qp_alloc_size;
     int use_bframe_qp;
@@ -180,13 +182,127 @@ static void store_slice_c(uint8_t *dst, const uint16_t *src,
     }
 }
 
-static void filter(USPPContext *p, uint8_t *dst[3], uint8_t *src[3],
+typedef struct ThreadData {
+    uint8_t **dst;
+    int *dst_stride;
+    int width, height;
+    int chroma;                 ///< chroma planes are filtered too
+} ThreadData;
+
+/**
+ * Encode and decode the frame for a range of shift offsets. Each job uses
+ * its own packet buffer; the decoded frames are summed afterwards.
+ */
+static int encode_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    USPPContext *p = ctx->priv;
+    const ThreadData *td = arg;
+    const int count = 1<<p->log2_count;
+    const int slice_start = (count *  jobnr   ) / nb_jobs;
+    const int slice_end   = (count * (jobnr+1)) / nb_jobs;
+    int i, ret;
+
+    for (i = slice_start; i < slice_end; i++) {
+        const int x1 = offset[i+count-1][0];
+        const int y1 = offset[i+count-1][1];
+        const int x1c = x1 >> p->hsub;
+        const int y1c = y1 >> p->vsub;
+        AVFrame *frame = p->frame[i];
+        AVPacket pkt = {0};
+        int got_pkt_ptr;
+
+        av_init_packet(&pkt);
+        pkt.data = p->outbuf + jobnr * p->outbuf_size;
+        pkt.size = p->outbuf_size;
+
+        frame->linesize[0] = p->temp_stride[0];
+        frame->linesize[1] = p->temp_stride[1];
+        frame->linesize[2] = p->temp_stride[2];
+        frame->data[0] = p->src[0] + x1   + y1   * frame->linesize[0];
+        frame->data[1] = p->src[1] + x1c  + y1c  * frame->linesize[1];
+        frame->data[2] = p->src[2] + x1c  + y1c  * frame->linesize[2];
+        frame->format  = p->avctx_enc[i]->pix_fmt;
+        frame->quality = p->quality;
+        frame->height  = td->height + BLOCK;
+        frame->width   = td->width + BLOCK;
+
+        ret = avcodec_encode_video2(p->avctx_enc[i], &pkt, frame, &got_pkt_ptr);
+        if (ret < 0) {
+            av_log(p->avctx_enc[i], AV_LOG_ERROR, "Encoding failed\n");
+            p->frame_dec[i] = NULL;
+            continue;
+        }
+
+        p->frame_dec[i] = p->avctx_enc[i]->coded_frame;
+    }
+    return 0;
+}
+
+/**
+ * Sum the decoded frames of all the shift offsets and store the result for a
+ * range of lines. Ranges start on multiples of 8 lines to keep the dither
+ * pattern aligned.
+ */
+static int store_slices(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    USPPContext *p = ctx->priv;
+    const ThreadData *td = arg;
+    const int count = 1<<p->log2_count;
+    int i, j, x, y;
+
+    for (j = 0; j < (td->chroma ? 3 : 1); j++) {
+        const int is_chroma = !!j;
+        const int width  = AV_CEIL_RSHIFT(td->width,  is_chroma ? p->hsub : 0);
+        const int height = AV_CEIL_RSHIFT(td->height, is_chroma ? p->vsub : 0);
+        const int nb_rows = (height + 7) >> 3;
+        const int slice_start = FFMIN(((nb_rows *  jobnr   ) / nb_jobs) * 8, height);
+        const int slice_end   = FFMIN(((nb_rows * (jobnr+1)) / nb_jobs) * 8, height);
+        const int block = BLOCK >> (is_chroma ? p->hsub : 0);
+        const int stride = p->temp_stride[j];
+        uint16_t *temp = p->temp[j];
+
+        for (y = slice_start; y < slice_end; y++)
+            memset(temp + y * stride, 0, width * sizeof(*temp));
+
+        for (i = 0; i < count; i++) {
+            const AVFrame *frame_dec = p->frame_dec[i];
+            const int x1 = offset[i+count-1][0] >> (is_chroma ? p->hsub : 0);
+            const int y1 = offset[i+count-1][1] >> (is_chroma ? p->vsub : 0);
+            const uint8_t *dec;
+
+            if (!frame_dec)
+                continue;
+
+            dec = frame_dec->data[j] + (block-x1) + (block-y1) * frame_dec->linesize[j];
+            for (y = slice_start; y < slice_end; y++)
+                for (x = 0; x < width; x++)
+                    temp[x + y * stride] += dec[x + y * frame_dec->linesize[j]];
+        }
+
+        if (!td->dst[j])
+            continue;
+        store_slice_c(td->dst[j] + slice_start * td->dst_stride[j],
+                      temp + slice_start * stride,
+                      td->dst_stride[j], stride,
+                      width, slice_end - slice_start, 8-p->log2_count);
+    }
+    return 0;
+}
+
+static void filter(AVFilterContext *ctx, uint8_t *dst[3], uint8_t *src[3],
                    int dst_stride[3], int src_stride[3], int width,
                    int height, uint8_t *qp_store, int qp_stride)
 {
-    int x, y, i, j;
+    USPPContext *p = ctx->priv;
+    int x, y, i;
     const int count = 1<<p->log2_count;
-    int ret;
+    ThreadData td = {
+        .dst        = dst,
+        .dst_stride = dst_stride,
+        .width      = width,
+        .height     = height,
+        .chroma     = src[2] && dst[2],
+    };
 
     for (i = 0; i < 3; i++) {
         int is_chroma = !!i;
@@ -210,13 +326,10 @@ static void filter(USPPContext *p, uint8_t *dst[3], uint8_t *src[3],
             memcpy(p->src[i] + (  block-1-y) * stride, p->src[i] + (  y+block  ) * stride, stride);
             memcpy(p->src[i] + (h+block  +y) * stride, p->src[i] + (h-y+block-1) * stride, stride);
         }
-
-        p->frame->linesize[i] = stride;
-        memset(p->temp[i], 0, (h + 2 * block) * stride * sizeof(int16_t));
     }
 
     if (p->qp)
-        p->frame->quality = p->qp * FF_QP2LAMBDA;
+        p->quality = p->qp * FF_QP2LAMBDA;
     else {
         int qpsum=0;
         int qpcount = (height>>4) * (height>>4);
@@ -225,67 +338,14 @@ static void filter(USPPContext *p, uint8_t *dst[3], uint8_t *src[3],
             for (x = 0; x < (width>>4); x++)
                 qpsum += qp_store[x + y * qp_stride];
         }
-        p->frame->quality = ff_norm_qscale((qpsum + qpcount/2) / qpcount, p->qscale_type) * FF_QP2LAMBDA;
+        p->quality = ff_norm_qscale((qpsum + qpcount/2) / qpcount, p->qscale_type) * FF_QP2LAMBDA;
     }
 //    init per MB qscale stuff FIXME
-    p->frame->height = height + BLOCK;
-    p->frame->width  = width + BLOCK;
-
-    for (i = 0; i < count; i++) {
-        const int x1 = offset[i+count-1][0];
-        const int y1 = offset[i+count-1][1];
-        const int x1c = x1 >> p->hsub;
-        const int y1c = y1 >> p->vsub;
-        const int BLOCKc = BLOCK >> p->hsub;
-        int offset;
-        AVPacket pkt = {0};
-        int got_pkt_ptr;
-
-        av_init_packet(&pkt);
-        pkt.data = p->outbuf;
-        pkt.size = p->outbuf_size;
-
-        p->frame->data[0] = p->src[0] + x1   + y1   * p->frame->linesize[0];
-        p->frame->data[1] = p->src[1] + x1c  + y1c  * p->frame->linesize[1];
-        p->frame->data[2] = p->src[2] + x1c  + y1c  * p->frame->linesize[2];
-        p->frame->format  = p->avctx_enc[i]->pix_fmt;
-
-        ret = avcodec_encode_video2(p->avctx_enc[i], &pkt, p->frame, &got_pkt_ptr);
-        if (ret < 0) {
-            av_log(p->avctx_enc[i], AV_LOG_ERROR, "Encoding failed\n");
-            continue;
-        }
-
-        p->frame_dec = p->avctx_enc[i]->coded_frame;
-
-        offset = (BLOCK-x1) + (BLOCK-y1) * p->frame_dec->linesize[0];
-
-        for (y = 0; y < height; y++)
-            for (x = 0; x < width; x++)
-                p->temp[0][x + y * p->temp_stride[0]] += p->frame_dec->data[0][x + y * p->frame_dec->linesize[0] + offset];
-
-        if (!src[2] || !dst[2])
-            continue;
-
-        offset = (BLOCKc-x1c) + (BLOCKc-y1c) * p->frame_dec->linesize[1];
 
-        for (y = 0; y < AV_CEIL_RSHIFT(height, p->vsub); y++) {
-            for (x = 0; x < AV_CEIL_RSHIFT(width, p->hsub); x++) {
-                p->temp[1][x + y * p->temp_stride[1]] += p->frame_dec->data[1][x + y * p->frame_dec->linesize[1] + offset];
-                p->temp[2][x + y * p->temp_stride[2]] += p->frame_dec->data[2][x + y * p->frame_dec->linesize[2] + offset];
-            }
-        }
-    }
-
-    for (j = 0; j < 3; j++) {
-        int is_chroma = !!j;
-        if (!dst[j])
-            continue;
-        store_slice_c(dst[j], p->temp[j], dst_stride[j], p->temp_stride[j],
-                      AV_CEIL_RSHIFT(width,  is_chroma ? p->hsub : 0),
-                      AV_CEIL_RSHIFT(height, is_chroma ? p->vsub : 0),
-                      8-p->log2_count);
-    }
+    ctx->internal->execute(ctx, encode_slice, &td, NULL,
+                           FFMIN(count, p->nb_threads));
+    ctx->internal->execute(ctx, store_slices, &td, NULL,
+                           FFMIN((height + 7) >> 3, p->nb_threads));
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -324,6 +384,7 @@ static int config_input(AVFilterLink *inlink)
 
     uspp->hsub = desc->log2_chroma_w;
     uspp->vsub = desc->log2_chroma_h;
+    uspp->nb_threads = ff_filter_get_nb_threads(ctx);
 
     for (i = 0; i < 3; i++) {
         int is_chroma = !!i;
@@ -349,6 +410,8 @@ static int config_input(AVFilterLink *inlink)
 
         if (!(uspp->avctx_enc[i] = avcodec_alloc_context3(NULL)))
             return AVERROR(ENOMEM);
+        if (!(uspp->frame[i] = av_frame_alloc()))
+            return AVERROR(ENOMEM);
 
         avctx_enc = uspp->avctx_enc[i];
         avctx_enc->width = width + BLOCK;
@@ -369,9 +432,8 @@ static int config_input(AVFilterLink *inlink)
     }
 
     uspp->outbuf_size = (width + BLOCK) * (height + BLOCK) * 10;
-    if (!(uspp->frame = av_frame_alloc()))
-        return AVERROR(ENOMEM);
-    if (!(uspp->outbuf = av_malloc(uspp->outbuf_size)))
+    if (!(uspp->outbuf = av_malloc_array(FFMIN(1 << uspp->log2_count, uspp->nb_threads),
+                                         uspp->outbuf_size)))
         return AVERROR(ENOMEM);
 
     return 0;
@@ -443,7 +505,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
                 out->height = in->height;
             }
 
-            filter(uspp, out->data, in->data, out->linesize, in->linesize,
+            filter(ctx, out->data, in->data, out->linesize, in->linesize,
                    inlink->w, inlink->h, qp_table, qp_stride);
         }
     }
@@ -471,11 +533,11 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < (1 << uspp->log2_count); i++) {
         avcodec_close(uspp->avctx_enc[i]);
         av_freep(&uspp->avctx_enc[i]);
+        av_frame_free(&uspp->frame[i]);
     }
 
     av_freep(&uspp->non_b_qp_table);
     av_freep(&uspp->outbuf);
-    av_frame_free(&uspp->frame);
 }
 
 static const AVFilterPad uspp_inputs[] = {
@@ -505,5 +567,5 @@ AVFilter ff_vf_uspp = {
     .inputs          = uspp_inputs,
     .outputs         = uspp_outputs,
     .priv_class      = &uspp_class,
-    .flags           = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags           = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_SLICE_THREADS,
 };
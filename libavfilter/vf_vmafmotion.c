@@ -45,6 +45,8 @@ static const float FILTER_5[5] = {
 typedef struct VMAFMotionContext {
     const AVClass *class;
     VMAFMotionData data;
+    int nb_threads;
+    uint64_t *sad;
     FILE *stats_file;
     char *stats_file_str;
 } VMAFMotionContext;
@@ -128,8 +130,8 @@ static void convolution_x(const uint16_t *filter, int filt_w, const uint16_t *sr
 #define conv_y_fn(type, bits) \
 static void convolution_y_##bits##bit(const uint16_t *filter, int filt_w, \
                                       const uint8_t *_src, uint16_t *dst, \
-                                      int w, int h, ptrdiff_t _src_stride, \
-                                      ptrdiff_t _dst_stride) \
+                                      int w, int h, int slice_start, int slice_end, \
+                                      ptrdiff_t _src_stride, ptrdiff_t _dst_stride) \
 { \
     const type *src = (const type *) _src; \
     ptrdiff_t src_stride = _src_stride / sizeof(*src); \
@@ -140,39 +142,27 @@ static void convolution_y_##bits##bit(const uint16_t *filter, int filt_w, \
     int i, j, k; \
     int sum = 0; \
     \
-    for (i = 0; i < borders_top; i++) { \
-        for (j = 0; j < w; j++) { \
-            sum = 0; \
-            for (k = 0; k < filt_w; k++) { \
-                int i_tap = FFABS(i - radius + k); \
-                if (i_tap >= h) { \
-                    i_tap = h - (i_tap - h + 1); \
+    for (i = slice_start; i < slice_end; i++) { \
+        if (i < borders_top || i >= borders_bottom) { \
+            for (j = 0; j < w; j++) { \
+                sum = 0; \
+                for (k = 0; k < filt_w; k++) { \
+                    int i_tap = FFABS(i - radius + k); \
+                    if (i_tap >= h) { \
+                        i_tap = h - (i_tap - h + 1); \
+                    } \
+                    sum += filter[k] * src[i_tap * src_stride + j]; \
                 } \
-                sum += filter[k] * src[i_tap * src_stride + j]; \
+                dst[i * dst_stride + j] = sum >> bits; \
             } \
-            dst[i * dst_stride + j] = sum >> bits; \
-        } \
-    } \
-    for (i = borders_top; i < borders_bottom; i++) { \
-        for (j = 0; j < w; j++) { \
-            sum = 0; \
-            for (k = 0; k < filt_w; k++) { \
-                sum += filter[k] * src[(i - radius + k) * src_stride + j]; \
-            } \
-            dst[i * dst_stride + j] = sum >> bits; \
-        } \
-    } \
-    for (i = borders_bottom; i < h; i++) { \
-        for (j = 0; j < w; j++) { \
-            sum = 0; \
-            for (k = 0; k < filt_w; k++) { \
-                int i_tap = FFABS(i - radius + k); \
-                if (i_tap >= h) { \
-                    i_tap = h - (i_tap - h + 1); \
+        } else { \
+            for (j = 0; j < w; j++) { \
+                sum = 0; \
+                for (k = 0; k < filt_w; k++) { \
+                    sum += filter[k] * src[(i - radius + k) * src_stride + j]; \
                 } \
-                sum += filter[k] * src[i_tap * src_stride + j]; \
+                dst[i * dst_stride + j] = sum >> bits; \
             } \
-            dst[i * dst_stride + j] = sum >> bits; \
         } \
     } \
 }
@@ -186,20 +176,33 @@ static void vmafmotiondsp_init(VMAFMotionDSPContext *dsp, int bpp) {
     dsp->sad = image_sad;
 }
 
-double ff_vmafmotion_process(VMAFMotionData *s, AVFrame *ref)
+uint64_t ff_vmafmotion_process_slice(VMAFMotionData *s, const uint8_t *src, ptrdiff_t src_stride,
+                                     int slice_start, int slice_end)
 {
-    double score;
+    const ptrdiff_t offset = slice_start * s->stride / sizeof(uint16_t);
 
-    s->vmafdsp.convolution_y(s->filter, 5, ref->data[0], s->temp_data,
-                             s->width, s->height, ref->linesize[0], s->stride);
-    s->vmafdsp.convolution_x(s->filter, 5, s->temp_data, s->blur_data[0],
-                             s->width, s->height, s->stride, s->stride);
+    if (slice_start >= slice_end)
+        return 0;
+
+    s->vmafdsp.convolution_y(s->filter, 5, src, s->temp_data,
+                             s->width, s->height, slice_start, slice_end,
+                             src_stride, s->stride);
+    s->vmafdsp.convolution_x(s->filter, 5, s->temp_data + offset, s->blur_data[0] + offset,
+                             s->width, slice_end - slice_start, s->stride, s->stride);
+
+    if (!s->nb_frames)
+        return 0;
+    return s->vmafdsp.sad(s->blur_data[1] + offset, s->blur_data[0] + offset,
+                          s->width, slice_end - slice_start, s->stride, s->stride);
+}
+
+double ff_vmafmotion_end_frame(VMAFMotionData *s, uint64_t sad)
+{
+    double score;
 
     if (!s->nb_frames) {
         score = 0.0;
     } else {
-        uint64_t sad = s->vmafdsp.sad(s->blur_data[1], s->blur_data[0],
-                                      s->width, s->height, s->stride, s->stride);
         // the output score is always normalized to 8 bits
         score = (double) (sad * 1.0 / (s->width * s->height << (BIT_SHIFT - 8)));
     }
@@ -211,6 +214,13 @@ double ff_vmafmotion_process(VMAFMotionData *s, AVFrame *ref)
     return score;
 }
 
+double ff_vmafmotion_process(VMAFMotionData *s, AVFrame *ref)
+{
+    uint64_t sad = ff_vmafmotion_process_slice(s, ref->data[0], ref->linesize[0],
+                                               0, s->height);
+    return ff_vmafmotion_end_frame(s, sad);
+}
+
 static void set_meta(AVDictionary **metadata, const char *key, float d)
 {
     char value[128];
@@ -218,12 +228,31 @@ static void set_meta(AVDictionary **metadata, const char *key, float d)
     av_dict_set(metadata, key, value, 0);
 }
 
+static int vmafmotion_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFMotionContext *s = ctx->priv;
+    const AVFrame *ref = arg;
+    const int slice_start = (s->data.height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (s->data.height * (jobnr + 1)) / nb_jobs;
+
+    s->sad[jobnr] = ff_vmafmotion_process_slice(&s->data, ref->data[0], ref->linesize[0],
+                                                slice_start, slice_end);
+    return 0;
+}
+
 static void do_vmafmotion(AVFilterContext *ctx, AVFrame *ref)
 {
     VMAFMotionContext *s = ctx->priv;
+    const int nb_jobs = FFMIN(s->data.height, s->nb_threads);
+    uint64_t sad = 0;
     double score;
+    int i;
+
+    ctx->internal->execute(ctx, vmafmotion_slice, ref, NULL, nb_jobs);
+    for (i = 0; i < nb_jobs; i++)
+        sad += s->sad[i];
 
-    score = ff_vmafmotion_process(&s->data, ref);
+    score = ff_vmafmotion_end_frame(&s->data, sad);
     set_meta(&ref->metadata, "lavfi.vmafmotion.score", score);
     if (s->stats_file) {
         fprintf(s->stats_file,
@@ -282,6 +311,11 @@ static int config_input_ref(AVFilterLink *inlink)
     AVFilterContext *ctx  = inlink->dst;
     VMAFMotionContext *s = ctx->priv;
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->sad = av_calloc(s->nb_threads, sizeof(*s->sad));
+    if (!s->sad)
+        return AVERROR(ENOMEM);
+
     return ff_vmafmotion_init(&s->data, ctx->inputs[0]->w,
                               ctx->inputs[0]->h, ctx->inputs[0]->format);
 }
@@ -336,6 +370,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     if (s->stats_file && s->stats_file != stdout)
         fclose(s->stats_file);
+
+    av_freep(&s->sad);
 }
 
 static const AVFilterPad vmafmotion_inputs[] = {
@@ -366,4 +402,5 @@ AVFilter ff_vf_vmafmotion = {
     .priv_class    = &vmafmotion_class,
     .inputs        = vmafmotion_inputs,
     .outputs       = vmafmotion_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -32,9 +32,12 @@ typedef struct VMAFMotionDSPContext {
     void (*convolution_x)(const uint16_t *filter, int filt_w, const uint16_t *src,
                           uint16_t *dst, int w, int h, ptrdiff_t src_stride,
                           ptrdiff_t dst_stride);
+    /**
+     * Filter the lines slice_start to slice_end - 1 of a w x h image.
+     */
     void (*convolution_y)(const uint16_t *filter, int filt_w, const uint8_t *src,
-                          uint16_t *dst, int w, int h, ptrdiff_t src_stride,
-                          ptrdiff_t dst_stride);
+                          uint16_t *dst, int w, int h, int slice_start, int slice_end,
+                          ptrdiff_t src_stride, ptrdiff_t dst_stride);
 } VMAFMotionDSPContext;
 
 void ff_vmafmotion_init_x86(VMAFMotionDSPContext *dsp);
@@ -53,6 +56,23 @@ typedef struct VMAFMotionData {
 
 int ff_vmafmotion_init(VMAFMotionData *data, int w, int h, enum AVPixelFormat fmt);
 double ff_vmafmotion_process(VMAFMotionData *data, AVFrame *frame);
+
+/**
+ * Blur the lines slice_start to slice_end - 1 of the luma plane of a frame.
+ * Different slices of the same frame can be processed concurrently.
+ *
+ * @return the SAD of the blurred lines against the previous frame
+ */
+uint64_t ff_vmafmotion_process_slice(VMAFMotionData *data, const uint8_t *src, ptrdiff_t src_stride,
+                                     int slice_start, int slice_end);
+
+/**
+ * Finish a frame processed with ff_vmafmotion_process_slice().
+ *
+ * @param sad the sum of the SAD of all the slices
+ * @return the motion score of the frame
+ */
+double ff_vmafmotion_end_frame(VMAFMotionData *data, uint64_t sad);
 double ff_vmafmotion_uninit(VMAFMotionData *data);
 
 #endif /* AVFILTER_VMAF_MOTION_H */
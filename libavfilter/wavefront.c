@@ -0,0 +1,116 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+
+#include "internal.h"
+#include "wavefront.h"
+
+int ff_wavefront_init(FFWavefront *wf, int nb_rows)
+{
+    int i;
+
+#if HAVE_THREADS
+    if (!wf->sync_init) {
+        int ret;
+
+        if ((ret = pthread_mutex_init(&wf->lock, NULL)))
+            return AVERROR(ret);
+        if ((ret = pthread_cond_init(&wf->cond, NULL))) {
+            pthread_mutex_destroy(&wf->lock);
+            return AVERROR(ret);
+        }
+        wf->sync_init = 1;
+    }
+#endif
+
+    av_freep(&wf->progress);
+    av_freep(&wf->waiting);
+    wf->nb_rows = 0;
+
+    wf->progress = av_malloc_array(nb_rows, sizeof(*wf->progress));
+    wf->waiting  = av_malloc_array(nb_rows, sizeof(*wf->waiting));
+    if (!wf->progress || !wf->waiting)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < nb_rows; i++) {
+        atomic_init(&wf->progress[i], 0);
+        atomic_init(&wf->waiting[i],  0);
+    }
+    wf->nb_rows = nb_rows;
+
+    return 0;
+}
+
+void ff_wavefront_uninit(FFWavefront *wf)
+{
+    av_freep(&wf->progress);
+    av_freep(&wf->waiting);
+    wf->nb_rows = 0;
+#if HAVE_THREADS
+    if (wf->sync_init) {
+        pthread_mutex_destroy(&wf->lock);
+        pthread_cond_destroy(&wf->cond);
+        wf->sync_init = 0;
+    }
+#endif
+}
+
+void ff_wavefront_reset(FFWavefront *wf)
+{
+    int i;
+
+    for (i = 0; i < wf->nb_rows; i++)
+        atomic_store(&wf->progress[i], 0);
+}
+
+void ff_wavefront_wait(FFWavefront *wf, int row, int progress)
+{
+#if HAVE_THREADS
+    if (atomic_load(&wf->progress[row]) >= progress)
+        return;
+    pthread_mutex_lock(&wf->lock);
+    atomic_store(&wf->waiting[row], 1);
+    while (atomic_load(&wf->progress[row]) < progress)
+        pthread_cond_wait(&wf->cond, &wf->lock);
+    atomic_store(&wf->waiting[row], 0);
+    pthread_mutex_unlock(&wf->lock);
+#endif
+}
+
+void ff_wavefront_report(FFWavefront *wf, int row, int progress)
+{
+#if HAVE_THREADS
+    atomic_store(&wf->progress[row], progress);
+    if (atomic_load(&wf->waiting[row])) {
+        pthread_mutex_lock(&wf->lock);
+        pthread_cond_broadcast(&wf->cond);
+        pthread_mutex_unlock(&wf->lock);
+    }
+#endif
+}
+
+int ff_wavefront_max_jobs(AVFilterContext *ctx)
+{
+    /* The thread pool of the graph runs up to nb_threads jobs at once, any
+     * other execute callback gives no such guarantee. */
+    if (HAVE_THREADS && ctx->thread_type & AVFILTER_THREAD_SLICE &&
+        ctx->graph->internal->thread)
+        return ff_filter_get_nb_threads(ctx);
+    return 1;
+}
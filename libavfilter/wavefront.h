@@ -0,0 +1,82 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_WAVEFRONT_H
+#define AVFILTER_WAVEFRONT_H
+
+/**
+ * FFWavefront: row progress tracking for slice jobs that depend on the
+ * row above, e.g. recursive filters or predictive motion searches.
+ *
+ * A job processing a row waits until the row above has progressed far
+ * enough, and reports its own progress for the row below. Since a job may
+ * wait for any other job, all jobs of one execute() call must run
+ * concurrently; ff_wavefront_max_jobs() returns how many jobs that allows.
+ */
+
+#include "config.h"
+
+#include <stdatomic.h>
+
+#include "libavutil/thread.h"
+
+#include "avfilter.h"
+
+typedef struct FFWavefront {
+    atomic_int *progress;
+    atomic_int *waiting;
+    int nb_rows;
+#if HAVE_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int sync_init;
+#endif
+} FFWavefront;
+
+/**
+ * Allocate the progress of nb_rows rows. May be called again to change the
+ * number of rows; ff_wavefront_uninit() must be called in any case.
+ */
+int ff_wavefront_init(FFWavefront *wf, int nb_rows);
+
+void ff_wavefront_uninit(FFWavefront *wf);
+
+/**
+ * Reset the progress of all rows to 0.
+ */
+void ff_wavefront_reset(FFWavefront *wf);
+
+/**
+ * Wait until the row has progressed to at least progress.
+ */
+void ff_wavefront_wait(FFWavefront *wf, int row, int progress);
+
+/**
+ * Set the progress of the row and wake up the jobs waiting for it.
+ */
+void ff_wavefront_report(FFWavefront *wf, int row, int progress);
+
+/**
+ * Return the maximum number of jobs a wavefront may be split into: the
+ * number of threads if the jobs are run concurrently by the slice threads
+ * of the graph, 1 otherwise (e.g. no slice threading or a custom
+ * AVFilterGraph.execute, which may run the jobs one after the other).
+ */
+int ff_wavefront_max_jobs(AVFilterContext *ctx);
+
+#endif /* AVFILTER_WAVEFRONT_H */
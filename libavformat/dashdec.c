@@ -160,6 +160,7 @@ typedef struct DASHContext {
     int is_live;
     AVIOInterruptCB *interrupt_callback;
     char *allowed_extensions;
+    int http_reuse_connections;
     AVDictionary *avio_opts;
     int max_url_size;
 
@@ -439,7 +440,9 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
             return AVERROR_INVALIDDATA;
         }
     } else if (av_strstart(proto_name, "http", NULL)) {
-        ;
+        /* Segments are usually fetched from the same server one after the
+         * other, so keep their connections around for the next request. */
+        av_dict_set_int(&tmp, "reuse_connections", c->http_reuse_connections, 0);
     } else
         return AVERROR_INVALIDDATA;
 
@@ -2327,6 +2330,9 @@ static const AVOption dash_options[] = {
         OFFSET(allowed_extensions), AV_OPT_TYPE_STRING,
         {.str = "aac,m4a,m4s,m4v,mov,mp4,webm"},
         INT_MIN, INT_MAX, FLAGS},
+    {"http_reuse_connections", "reuse HTTP(S) connections for later segment requests",
+        OFFSET(http_reuse_connections), AV_OPT_TYPE_BOOL, {.i64 = 1},
+        0, 1, FLAGS},
     {NULL}
 };
 
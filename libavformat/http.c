@@ -30,6 +30,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -37,6 +38,7 @@
 #include "internal.h"
 #include "network.h"
 #include "os_support.h"
+#include "tls.h"
 #include "url.h"
 
 /* XXX: POST protocol is not completely implemented because ffmpeg uses
@@ -51,6 +53,7 @@
 #define HTTP_MUTLI    2
 #define MAX_EXPIRY    19
 #define WHITESPACES " \n\t\r"
+#define POOL_MAX_SIZE 64
 typedef enum {
     LOWER_PROTO,
     READ_HEADERS,
@@ -125,8 +128,23 @@ typedef struct HTTPContext {
     int is_multi_client;
     HandshakeState handshake_step;
     int is_connected_server;
+    /* A flag which indicates if idle connections are kept in the pool. */
+    int reuse_connections;
+    int pool_idle_timeout;
+    int pool_size;
+    /* Key the connection is pooled under, empty if none. */
+    char pool_key[2048];
 } HTTPContext;
 
+typedef struct HTTPPoolEntry {
+    char key[2048];
+    URLContext *hd;
+    int64_t expiry;
+} HTTPPoolEntry;
+
+static AVMutex pool_mutex = AV_MUTEX_INITIALIZER;
+static HTTPPoolEntry pool[POOL_MAX_SIZE];
+
 #define OFFSET(x) offsetof(HTTPContext, x)
 #define D AV_OPT_FLAG_DECODING_PARAM
 #define E AV_OPT_FLAG_ENCODING_PARAM
@@ -167,6 +185,9 @@ static const AVOption options[] = {
     { "listen", "listen on HTTP", OFFSET(listen), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 2, D | E },
     { "resource", "The resource requested by a client", OFFSET(resource), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "reply_code", "The http status code to return to a client", OFFSET(reply_code), AV_OPT_TYPE_INT, { .i64 = 200}, INT_MIN, 599, E},
+    { "reuse_connections", "keep idle connections in a process wide pool for later requests", OFFSET(reuse_connections), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    { "pool_idle_timeout", "time in seconds an idle connection is kept in the pool", OFFSET(pool_idle_timeout), AV_OPT_TYPE_INT, { .i64 = 30 }, 0, 3600, D },
+    { "pool_size", "maximum number of idle connections kept in the pool", OFFSET(pool_size), AV_OPT_TYPE_INT, { .i64 = 16 }, 0, POOL_MAX_SIZE, D },
     { NULL }
 };
 
@@ -186,6 +207,170 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
            sizeof(HTTPAuthState));
 }
 
+/* Must be called with pool_mutex held. */
+static void pool_expire(int64_t now)
+{
+    int i;
+
+    for (i = 0; i < POOL_MAX_SIZE; i++)
+        if (pool[i].hd && pool[i].expiry <= now)
+            ffurl_closep(&pool[i].hd);
+}
+
+/*
+ * A pooled connection must behave as if it had been opened by the new owner,
+ * so the key contains the lower protocol URL, the rw_timeout applied to it
+ * and the options it was opened with. Return 0 if the key does not fit.
+ */
+static int pool_make_key(URLContext *h, const char *url, AVDictionary *options,
+                         char *key, int size)
+{
+    char *opts = NULL;
+    int len;
+
+    if (av_dict_get_string(options, &opts, '=', ',') < 0)
+        return 0;
+    len = snprintf(key, size, "%s|%"PRId64"|%s", url, h->rw_timeout, opts);
+    av_free(opts);
+    return len < size;
+}
+
+/* Apply the protocol white- and blacklist checks of ffurl_connect(). */
+static int pool_check_protocol(URLContext *h, const char *name)
+{
+    if (h->protocol_whitelist && av_match_list(name, h->protocol_whitelist, ',') <= 0)
+        return 0;
+    if (h->protocol_blacklist && av_match_list(name, h->protocol_blacklist, ',') > 0)
+        return 0;
+    /* A TLS connection also opens a TCP connection of its own. */
+    if (!strcmp(name, "tls"))
+        return pool_check_protocol(h, "tcp");
+    return 1;
+}
+
+/*
+ * Hand the connection over to a new owner. A TLS connection does its I/O
+ * through an underlying TCP (or CONNECT proxy) context, which has to be
+ * updated too.
+ */
+static void pool_set_interrupt_callback(URLContext *hd, const AVIOInterruptCB *cb)
+{
+    URLContext *lower = NULL;
+
+    hd->interrupt_callback = *cb;
+    if (!strcmp(hd->prot->name, "httpproxy"))
+        lower = ((HTTPContext *)hd->priv_data)->hd;
+#if CONFIG_TLS_PROTOCOL
+    else if (!strcmp(hd->prot->name, "tls"))
+        lower = ff_tls_get_underlying(hd);
+#endif
+    if (lower)
+        pool_set_interrupt_callback(lower, cb);
+}
+
+static URLContext *pool_get(URLContext *h, const char *key)
+{
+    URLContext *hd = NULL;
+    int i;
+
+    ff_mutex_lock(&pool_mutex);
+    pool_expire(av_gettime_relative());
+    for (i = 0; i < POOL_MAX_SIZE; i++) {
+        if (pool[i].hd && !strcmp(pool[i].key, key)) {
+            hd = pool[i].hd;
+            pool[i].hd = NULL;
+            break;
+        }
+    }
+    ff_mutex_unlock(&pool_mutex);
+
+    if (hd) {
+        char *whitelist = av_strdup(h->protocol_whitelist);
+        char *blacklist = av_strdup(h->protocol_blacklist);
+        if ((h->protocol_whitelist && !whitelist) ||
+            (h->protocol_blacklist && !blacklist)) {
+            av_free(whitelist);
+            av_free(blacklist);
+            ffurl_closep(&hd);
+            return NULL;
+        }
+        av_freep(&hd->protocol_whitelist);
+        av_freep(&hd->protocol_blacklist);
+        hd->protocol_whitelist = whitelist;
+        hd->protocol_blacklist = blacklist;
+        pool_set_interrupt_callback(hd, &h->interrupt_callback);
+    }
+    return hd;
+}
+
+void ff_http_pool_flush(void)
+{
+    int i;
+
+    ff_mutex_lock(&pool_mutex);
+    for (i = 0; i < POOL_MAX_SIZE; i++)
+        ffurl_closep(&pool[i].hd);
+    ff_mutex_unlock(&pool_mutex);
+}
+
+static void pool_put(const char *key, URLContext *hd, int timeout, int size)
+{
+    int64_t now = av_gettime_relative();
+    int i, used = 0, slot = -1, oldest = -1;
+
+    if (!size) {
+        ffurl_closep(&hd);
+        return;
+    }
+
+    /* The owner of the interrupt callback may be gone once the connection
+     * is taken out of the pool again. */
+    pool_set_interrupt_callback(hd, &(AVIOInterruptCB){ NULL, NULL });
+
+    ff_mutex_lock(&pool_mutex);
+    pool_expire(now);
+    /* Use a free slot, or evict the connection closest to expiry if the
+     * pool already holds size connections. */
+    for (i = 0; i < POOL_MAX_SIZE; i++) {
+        if (!pool[i].hd) {
+            if (slot < 0)
+                slot = i;
+            continue;
+        }
+        used++;
+        if (oldest < 0 || pool[i].expiry < pool[oldest].expiry)
+            oldest = i;
+    }
+    if (slot < 0 || used >= size) {
+        slot = oldest;
+        ffurl_closep(&pool[slot].hd);
+    }
+    av_strlcpy(pool[slot].key, key, sizeof(pool[slot].key));
+    pool[slot].hd     = hd;
+    pool[slot].expiry = now + timeout * 1000000LL;
+    ff_mutex_unlock(&pool_mutex);
+}
+
+/* Check whether the connection is idle and can take another request. */
+static int http_connection_reusable(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    uint64_t target_end = s->end_off ? s->end_off : s->filesize;
+
+    if (!*s->pool_key || s->willclose || h->flags & AVIO_FLAG_WRITE ||
+        s->post_data || (s->method && strcmp(s->method, "GET")) ||
+        s->http_code < 200 || s->http_code >= 300 ||
+        s->buf_ptr != s->buf_end)
+        return 0;
+#if CONFIG_ZLIB
+    if (s->compressed)
+        return 0;
+#endif /* CONFIG_ZLIB */
+    if (s->chunksize != UINT64_MAX)
+        return s->chunkend;
+    return s->filesize != UINT64_MAX && s->off >= target_end;
+}
+
 static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 {
     const char *path, *proxy_path, *lower_proto = "tcp", *local_path;
@@ -193,7 +378,7 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     char auth[1024], proxyauth[1024] = "";
     char path1[MAX_URL_SIZE];
     char buf[1024], urlbuf[MAX_URL_SIZE];
-    int port, use_proxy, err, location_changed = 0;
+    int port, use_proxy, err, location_changed = 0, pooled = 0;
     HTTPContext *s = h->priv_data;
 
     av_url_split(proto, sizeof(proto), auth, sizeof(auth),
@@ -231,16 +416,32 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
-    if (!s->hd) {
-        err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
-                                   &h->interrupt_callback, options,
-                                   h->protocol_whitelist, h->protocol_blacklist, h);
-        if (err < 0)
-            return err;
-    }
+    if (!s->reuse_connections ||
+        !pool_make_key(h, buf, *options, s->pool_key, sizeof(s->pool_key)))
+        s->pool_key[0] = '\0';
 
-    err = http_connect(h, path, local_path, hoststr,
-                       auth, proxyauth, &location_changed);
+    /* A new connection would be rejected by ffurl_connect() in this case. */
+    if (!s->hd && *s->pool_key && pool_check_protocol(h, lower_proto))
+        pooled = !!(s->hd = pool_get(h, s->pool_key));
+
+    for (;;) {
+        if (!s->hd) {
+            err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
+                                       &h->interrupt_callback, options,
+                                       h->protocol_whitelist, h->protocol_blacklist, h);
+            if (err < 0)
+                return err;
+        }
+
+        err = http_connect(h, path, local_path, hoststr,
+                           auth, proxyauth, &location_changed);
+        if (err >= 0 || !pooled)
+            break;
+        /* The server may have closed the idle connection in the meantime. */
+        av_log(h, AV_LOG_DEBUG, "Pooled connection to %s failed, reconnecting\n", buf);
+        ffurl_closep(&s->hd);
+        pooled = 0;
+    }
     if (err < 0)
         return err;
 
@@ -554,6 +755,8 @@ static int http_open(URLContext *h, const char *uri, int flags,
     if (s->listen) {
         return http_listen(h, uri, flags, options);
     }
+    if (s->reuse_connections)
+        s->multiple_requests = 1;
     ret = http_open_cnx(h, options);
     if (ret < 0)
         av_dict_free(&s->chained_options);
@@ -1654,6 +1857,10 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
+    if (s->hd && http_connection_reusable(h)) {
+        pool_put(s->pool_key, s->hd, s->pool_idle_timeout, s->pool_size);
+        s->hd = NULL;
+    }
     if (s->hd)
         ffurl_closep(&s->hd);
     av_dict_free(&s->chained_options);
@@ -49,4 +49,9 @@ int ff_http_do_new_request(URLContext *h, const char *uri);
 
 int ff_http_averror(int status_code, int default_averror);
 
+/**
+ * Close all idle connections kept by the reuse_connections option.
+ */
+void ff_http_pool_flush(void);
+
 #endif /* AVFORMAT_HTTP_H */
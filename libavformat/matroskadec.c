@@ -3544,6 +3544,154 @@ static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
     return ret;
 }
 
+static int matroska_read_element_header(MatroskaDemuxContext *matroska,
+                                        uint32_t *id, uint64_t *length)
+{
+    uint64_t num;
+    int res = ebml_read_num(matroska, matroska->ctx->pb, 4, &num);
+    if (res < 0)
+        return res;
+    *id = num | 1 << 7 * res;
+    res = ebml_read_length(matroska, matroska->ctx->pb, length);
+    if (res < 0)
+        return res;
+    return *length == 0xffffffffffffffULL ? AVERROR_INVALIDDATA : 0;
+}
+
+static int matroska_read_block_header(MatroskaDemuxContext *matroska,
+                                      uint64_t *track_num, int *block_time,
+                                      int *flags, int *laces)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+    int res = ebml_read_num(matroska, pb, 8, track_num);
+    if (res < 0)
+        return res;
+    *block_time = sign_extend(avio_rb16(pb), 16);
+    *flags      = avio_r8(pb);
+    *laces      = *flags & 0x06 ? avio_r8(pb) + 1 : 1;
+    return 0;
+}
+
+/*
+ * Mirrors the indexing done by matroska_parse_block(), including the
+ * tracking of the end of subtitles, as overlapping subtitles are not
+ * keyframes.
+ */
+static void matroska_index_block(MatroskaDemuxContext *matroska,
+                                 uint64_t track_num, int block_time,
+                                 uint64_t block_duration, int laces,
+                                 int is_keyframe, uint64_t cluster_time,
+                                 int64_t cluster_pos)
+{
+    MatroskaTrack *track = matroska_find_track_by_num(matroska, track_num);
+    uint64_t timecode;
+    AVStream *st;
+
+    if (!track || !track->stream ||
+        cluster_time == (uint64_t) -1 ||
+        (block_time < 0 && cluster_time < -block_time))
+        return;
+    st = track->stream;
+    if (st->discard >= AVDISCARD_ALL)
+        return;
+
+    timecode = cluster_time + block_time - track->codec_delay_in_track_tb;
+    if (track->type == MATROSKA_TRACK_TYPE_SUBTITLE &&
+        timecode < track->end_timecode)
+        is_keyframe = 0;
+    if (is_keyframe) {
+        ff_reduce_index(matroska->ctx, st->index);
+        av_add_index_entry(st, cluster_pos, timecode, 0, 0, AVINDEX_KEYFRAME);
+    }
+
+    if (!block_duration)
+        block_duration = track->default_duration * laces / matroska->time_scale;
+    track->end_timecode = FFMAX(track->end_timecode, timecode + block_duration);
+}
+
+/*
+ * Add the keyframes of the cluster at the current position to the index,
+ * reading only the cluster timecode and the block headers and skipping the
+ * block payloads. This is much cheaper than parsing the cluster when there
+ * are no cues to seek with. Other top level elements are skipped.
+ * Return: 0 on success, < 0 if the element could not be scanned.
+ */
+static int matroska_index_cluster(MatroskaDemuxContext *matroska)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+    int64_t cluster_pos = avio_tell(pb), cluster_end, end;
+    uint64_t cluster_time = (uint64_t) -1, length, track_num;
+    uint32_t id;
+    int res, block_time, flags, laces;
+
+    if ((res = matroska_read_element_header(matroska, &id, &length)) < 0)
+        return res;
+    cluster_end = avio_tell(pb) + length;
+    if (id != MATROSKA_ID_CLUSTER)
+        goto end;
+
+    while (avio_tell(pb) < cluster_end) {
+        if ((res = matroska_read_element_header(matroska, &id, &length)) < 0)
+            return res;
+        end = avio_tell(pb) + length;
+
+        switch (id) {
+        case MATROSKA_ID_CLUSTERTIMECODE:
+            /* ebml_read_uint() takes an int size, check before truncating */
+            if (length > 8)
+                return AVERROR_INVALIDDATA;
+            if ((res = ebml_read_uint(pb, length, &cluster_time)) < 0)
+                return res;
+            break;
+        case MATROSKA_ID_SIMPLEBLOCK:
+            if ((res = matroska_read_block_header(matroska, &track_num,
+                                                  &block_time, &flags, &laces)) < 0)
+                return res;
+            matroska_index_block(matroska, track_num, block_time, 0, laces,
+                                 flags & 0x80, cluster_time, cluster_pos);
+            break;
+        case MATROSKA_ID_BLOCKGROUP: {
+            uint64_t duration = 0;
+            int has_block = 0, is_keyframe = 1;
+
+            while (avio_tell(pb) < end) {
+                int64_t child_end;
+                if ((res = matroska_read_element_header(matroska, &id, &length)) < 0)
+                    return res;
+                child_end = avio_tell(pb) + length;
+                if (id == MATROSKA_ID_BLOCK) {
+                    if ((res = matroska_read_block_header(matroska, &track_num,
+                                                          &block_time, &flags, &laces)) < 0)
+                        return res;
+                    has_block = 1;
+                } else if (id == MATROSKA_ID_BLOCKDURATION) {
+                    if (length > 8)
+                        return AVERROR_INVALIDDATA;
+                    if ((res = ebml_read_uint(pb, length, &duration)) < 0)
+                        return res;
+                } else if (id == MATROSKA_ID_BLOCKREFERENCE) {
+                    is_keyframe = 0;
+                }
+                if (avio_seek(pb, child_end, SEEK_SET) < 0)
+                    return AVERROR(EIO);
+            }
+            if (has_block)
+                matroska_index_block(matroska, track_num, block_time, duration,
+                                     laces, is_keyframe, cluster_time, cluster_pos);
+            break;
+        }
+        }
+
+        if (avio_seek(pb, end, SEEK_SET) < 0)
+            return AVERROR(EIO);
+    }
+
+end:
+    if (avio_seek(pb, cluster_end, SEEK_SET) < 0)
+        return AVERROR(EIO);
+    return 0;
+}
+
 static int matroska_read_seek(AVFormatContext *s, int stream_index,
                               int64_t timestamp, int flags)
 {
@@ -3566,6 +3714,15 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
         avio_seek(s->pb, st->index_entries[st->nb_index_entries - 1].pos,
                   SEEK_SET);
         matroska->current_id = 0;
+        /* First extend the index by skipping through the cluster headers. */
+        while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 || index == st->nb_index_entries - 1) {
+            int64_t pos = avio_tell(s->pb);
+            if (matroska_index_cluster(matroska) < 0) {
+                avio_seek(s->pb, pos, SEEK_SET);
+                break;
+            }
+        }
+        /* Parse the remaining clusters if the scan stopped early. */
         while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 || index == st->nb_index_entries - 1) {
             matroska_clear_queue(matroska);
             if (matroska_parse_cluster(matroska) < 0)
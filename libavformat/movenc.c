@@ -60,7 +60,8 @@
 static const AVOption options[] = {
     { "movflags", "MOV muxer flags", offsetof(MOVMuxContext, flags), AV_OPT_TYPE_FLAGS, {.i64 = 0}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "rtphint", "Add RTP hint tracks", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_RTP_HINT}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
-    { "moov_size", "maximum moov size so it can be placed at the begin", offsetof(MOVMuxContext, reserved_moov_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, 0 },
+    { "moov_size", "maximum moov size so it can be placed at the begin", offsetof(MOVMuxContext, reserved_moov_size), AV_OPT_TYPE_INT, {.i64 = 0}, -1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "moov_size" },
+    { "auto", "Estimate the moov size from the stream durations (requires faststart)", 0, AV_OPT_TYPE_CONST, {.i64 = -1}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "moov_size" },
     { "empty_moov", "Make the initial moov atom empty", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_EMPTY_MOOV}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "frag_keyframe", "Fragment at video keyframes", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_KEYFRAME}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "frag_every_frame", "Fragment at every frame", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_EVERY_FRAME}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -6021,6 +6022,44 @@ static int mov_create_dvd_sub_decoder_specific_info(MOVTrack *track,
     return 0;
 }
 
+/*
+ * Estimate an upper bound of the moov atom size from the expected number of
+ * samples, assuming one chunk per sample and no run length compression of the
+ * sample tables. Returns 0 if the stream durations are not known.
+ */
+static int estimate_moov_size(AVFormatContext *s)
+{
+    int64_t size = 4096; /* mvhd, udta and metadata */
+    int i;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        AVCodecParameters *par = st->codecpar;
+        int64_t samples, sample_size = 4 + 8 + 8; /* stsz, stts, co64 */
+
+        if (st->duration <= 0)
+            return 0;
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO && st->avg_frame_rate.num > 0 &&
+            st->avg_frame_rate.den > 0) {
+            samples      = av_rescale_q_rnd(st->duration, st->time_base,
+                                            av_inv_q(st->avg_frame_rate), AV_ROUND_UP);
+            sample_size += 4 + 8; /* stss, ctts */
+        } else if (par->codec_type == AVMEDIA_TYPE_AUDIO && par->sample_rate > 0) {
+            int frame_size = par->frame_size > 0 ? par->frame_size : 1024;
+            samples = av_rescale_q_rnd(st->duration, st->time_base,
+                                       (AVRational){ frame_size, par->sample_rate },
+                                       AV_ROUND_UP);
+        } else {
+            return 0;
+        }
+        size += 2048 + samples * sample_size;
+        if (size > INT_MAX)
+            return 0;
+    }
+
+    return size;
+}
+
 static int mov_init(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -6068,7 +6107,24 @@ static int mov_init(AVFormatContext *s)
     }
 
     if (mov->flags & FF_MOV_FLAG_FASTSTART) {
-        mov->reserved_moov_size = -1;
+        if (mov->reserved_moov_size < 0) {
+            mov->reserved_moov_size = estimate_moov_size(s);
+            if (mov->reserved_moov_size > 0)
+                av_log(s, AV_LOG_VERBOSE, "Reserving %d bytes for the moov atom\n",
+                       mov->reserved_moov_size);
+            else
+                av_log(s, AV_LOG_WARNING, "Cannot estimate the moov size without "
+                       "the stream durations, a second pass will be needed\n");
+        }
+        if (!mov->reserved_moov_size) {
+            mov->reserved_moov_size = -1;
+        } else if (mov->reserved_moov_size > 0 && mov->reserved_moov_size < 8) {
+            av_log(s, AV_LOG_ERROR, "moov_size must be at least 8 bytes\n");
+            return AVERROR(EINVAL);
+        }
+    } else if (mov->reserved_moov_size < 0) {
+        av_log(s, AV_LOG_ERROR, "moov_size=auto requires -movflags faststart\n");
+        return AVERROR(EINVAL);
     }
 
     if (mov->use_editlist < 0) {
@@ -6399,7 +6455,13 @@ static int mov_write_header(AVFormatContext *s)
 
     if (mov->reserved_moov_size){
         mov->reserved_header_pos = avio_tell(pb);
-        if (mov->reserved_moov_size > 0)
+        if (mov->reserved_moov_size > 0 && mov->flags & FF_MOV_FLAG_FASTSTART) {
+            /* The reserved space must be a valid atom, in case the moov
+             * does not fit and the second pass has to shift it as well. */
+            avio_wb32(pb, mov->reserved_moov_size);
+            ffio_wfourcc(pb, "free");
+            ffio_fill(pb, 0, mov->reserved_moov_size - 8);
+        } else if (mov->reserved_moov_size > 0)
             avio_skip(pb, mov->reserved_moov_size);
     }
 
@@ -6411,7 +6473,7 @@ static int mov_write_header(AVFormatContext *s)
             !mov->max_fragment_duration && !mov->max_fragment_size)
             mov->flags |= FF_MOV_FLAG_FRAG_KEYFRAME;
     } else {
-        if (mov->flags & FF_MOV_FLAG_FASTSTART)
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size < 0)
             mov->reserved_header_pos = avio_tell(pb);
         mov_write_mdat_tag(pb, mov);
     }
@@ -6672,9 +6734,22 @@ static int mov_write_trailer(AVFormatContext *s)
             ffio_wfourcc(pb, "mdat");
             avio_wb64(pb, mov->mdat_size + 16);
         }
+
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size > 0) {
+            /* The chunk offsets do not change when writing into the reserved
+             * space, so the moov size is final here. */
+            int moov_size = get_moov_size(s);
+            if (moov_size < 0)
+                return moov_size;
+            if (moov_size + 8 > mov->reserved_moov_size) {
+                av_log(s, AV_LOG_INFO, "moov atom (%d bytes) does not fit in the reserved %d bytes\n",
+                       moov_size, mov->reserved_moov_size);
+                mov->reserved_moov_size = -1;
+            }
+        }
         avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_header_pos : moov_pos, SEEK_SET);
 
-        if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size < 0) {
             av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
             res = shift_data(s);
             if (res < 0)
@@ -158,9 +158,17 @@ struct MpegTSContext {
     struct Program *prg;
 
     int8_t crc_validity[NB_PID_MAX];
+    /** cached discard_pid() results: 0 if unknown, 1 to keep, 2 to discard */
+    uint8_t discard_cache[NB_PID_MAX];
+    /** AVDISCARD_ALL state of each AVProgram when discard_cache was filled */
+    uint8_t *prg_discard;
+    unsigned int nb_prg_discard;
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
+
+    /** payload buffer pools, indexed by log2 of the buffer size */
+    AVBufferPool *pools[32];
 };
 
 #define MPEGTS_OPTIONS \
@@ -263,6 +271,11 @@ static struct Program * get_program(MpegTSContext *ts, unsigned int programid)
     return NULL;
 }
 
+static void invalidate_discard_cache(MpegTSContext *ts)
+{
+    memset(ts->discard_cache, 0, sizeof(ts->discard_cache));
+}
+
 static void clear_avprogram(MpegTSContext *ts, unsigned int programid)
 {
     AVProgram *prg = NULL;
@@ -283,6 +296,7 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
     int i;
 
     clear_avprogram(ts, programid);
+    invalidate_discard_cache(ts);
     for (i = 0; i < ts->nb_prg; i++)
         if (ts->prg[i].id == programid) {
             ts->prg[i].nb_pids = 0;
@@ -294,6 +308,7 @@ static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg = 0;
+    invalidate_discard_cache(ts);
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -308,6 +323,7 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p->nb_pids = 0;
     p->pmt_found = 0;
     ts->nb_prg++;
+    invalidate_discard_cache(ts);
 }
 
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
@@ -326,6 +342,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
             return;
 
     p->pids[p->nb_pids++] = pid;
+    invalidate_discard_cache(ts);
 }
 
 static void set_pmt_found(MpegTSContext *ts, unsigned int programid)
@@ -401,6 +418,49 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+/**
+ * Invalidate the discard_pid() cache if the caller changed the discard
+ * setting of any program since the cache was filled.
+ */
+static void update_discard_cache(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int changed = 0;
+    int k;
+
+    if (ts->nb_prg_discard != s->nb_programs) {
+        if (av_reallocp(&ts->prg_discard, s->nb_programs) < 0) {
+            ts->nb_prg_discard = 0;
+            invalidate_discard_cache(ts);
+            return;
+        }
+        memset(ts->prg_discard, 0, s->nb_programs);
+        ts->nb_prg_discard = s->nb_programs;
+        changed = 1;
+    }
+
+    for (k = 0; k < s->nb_programs; k++) {
+        uint8_t all = s->programs[k]->discard == AVDISCARD_ALL;
+        if (ts->prg_discard[k] != all) {
+            ts->prg_discard[k] = all;
+            changed = 1;
+        }
+    }
+
+    if (changed)
+        invalidate_discard_cache(ts);
+}
+
+static int discard_pid_cached(MpegTSContext *ts, unsigned int pid)
+{
+    /* the cache cannot track program changes without prg_discard */
+    if (!ts->prg_discard)
+        return discard_pid(ts, pid);
+    if (!ts->discard_cache[pid])
+        ts->discard_cache[pid] = 1 + discard_pid(ts, pid);
+    return ts->discard_cache[pid] - 1;
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -909,6 +969,18 @@ static void reset_pes_packet_state(PESContext *pes)
     av_buffer_unref(&pes->buffer);
 }
 
+static AVBufferRef *buffer_pool_get(MpegTSContext *ts, int size)
+{
+    int index = av_log2(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!ts->pools[index]) {
+        int pool_size = FFMIN(MAX_PES_PAYLOAD + AV_INPUT_BUFFER_PADDING_SIZE, 2 << index);
+        ts->pools[index] = av_buffer_pool_init(pool_size, NULL);
+        if (!ts->pools[index])
+            return NULL;
+    }
+    return av_buffer_pool_get(ts->pools[index]);
+}
+
 static void new_data_packet(const uint8_t *buffer, int len, AVPacket *pkt)
 {
     av_init_packet(pkt);
@@ -1108,8 +1180,7 @@ static int mpegts_push_data(MpegTSFilter *filter,
                         pes->total_size = MAX_PES_PAYLOAD;
 
                     /* allocate pes buffer */
-                    pes->buffer = av_buffer_alloc(pes->total_size +
-                                                  AV_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = buffer_pool_get(ts, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
 
@@ -1269,8 +1340,7 @@ skip:
                     if (ret < 0)
                         return ret;
                     pes->total_size = MAX_PES_PAYLOAD;
-                    pes->buffer = av_buffer_alloc(pes->total_size +
-                                                  AV_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = buffer_pool_get(ts, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
                     ts->stop_parse = 1;
@@ -2463,7 +2533,7 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
-    if (pid && discard_pid(ts, pid))
+    if (pid && discard_pid_cached(ts, pid))
         return 0;
     is_start = packet[1] & 0x40;
     tss = ts->pids[pid];
@@ -2631,7 +2701,7 @@ static int mpegts_resync(AVFormatContext *s, int seekback, const uint8_t *curren
 {
     MpegTSContext *ts = s->priv_data;
     AVIOContext *pb = s->pb;
-    int c, i;
+    int c, i, len;
     uint64_t pos = avio_tell(pb);
 
     avio_seek(pb, -FFMIN(seekback, pos), SEEK_CUR);
@@ -2642,15 +2712,32 @@ static int mpegts_resync(AVFormatContext *s, int seekback, const uint8_t *curren
         return 0;
     }
 
-    for (i = 0; i < ts->resync_size; i++) {
-        c = avio_r8(pb);
-        if (avio_feof(pb))
-            return AVERROR_EOF;
-        if (c == 0x47) {
-            avio_seek(pb, -1, SEEK_CUR);
+    for (i = 0; i < ts->resync_size; i += len) {
+        const uint8_t *sync;
+
+        if (pb->buf_ptr >= pb->buf_end) {
+            /* refill the buffer */
+            c = avio_r8(pb);
+            if (avio_feof(pb))
+                return AVERROR_EOF;
+            if (c == 0x47) {
+                avio_seek(pb, -1, SEEK_CUR);
+                reanalyze(s->priv_data);
+                return 0;
+            }
+            len = 1;
+            continue;
+        }
+
+        /* scan the buffered data in bulk instead of byte by byte */
+        len  = FFMIN(pb->buf_end - pb->buf_ptr, ts->resync_size - i);
+        sync = memchr(pb->buf_ptr, 0x47, len);
+        if (sync) {
+            avio_skip(pb, sync - pb->buf_ptr);
             reanalyze(s->priv_data);
             return 0;
         }
+        avio_skip(pb, len);
     }
     av_log(s, AV_LOG_ERROR,
            "max resync size reached, could not find sync byte\n");
@@ -2720,6 +2807,8 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         }
     }
 
+    update_discard_cache(ts);
+
     ts->stop_parse = 0;
     packet_num = 0;
     memset(packet + TS_PACKET_SIZE, 0, AV_INPUT_BUFFER_PADDING_SIZE);
@@ -2941,8 +3030,13 @@ static int mpegts_raw_read_packet(AVFormatContext *s, AVPacket *pkt)
     uint8_t pcr_buf[12];
     const uint8_t *data;
 
-    if (av_new_packet(pkt, TS_PACKET_SIZE) < 0)
+    av_init_packet(pkt);
+    pkt->buf = buffer_pool_get(ts, TS_PACKET_SIZE);
+    if (!pkt->buf)
         return AVERROR(ENOMEM);
+    pkt->data = pkt->buf->data;
+    pkt->size = TS_PACKET_SIZE;
+    memset(pkt->data + TS_PACKET_SIZE, 0, AV_INPUT_BUFFER_PADDING_SIZE);
     ret = read_packet(s, pkt->data, ts->raw_packet_size, &data);
     pkt->pos = avio_tell(s->pb);
     if (ret < 0) {
@@ -2950,7 +3044,7 @@ static int mpegts_raw_read_packet(AVFormatContext *s, AVPacket *pkt)
         return ret;
     }
     if (data != pkt->data)
-        memcpy(pkt->data, data, ts->raw_packet_size);
+        memcpy(pkt->data, data, TS_PACKET_SIZE);
     finished_reading_packet(s, ts->raw_packet_size);
     if (ts->mpeg2ts_compute_pcr) {
         /* compute exact PCR for each packet */
@@ -3015,6 +3109,11 @@ static void mpegts_free(MpegTSContext *ts)
     int i;
 
     clear_programs(ts);
+    av_freep(&ts->prg_discard);
+    ts->nb_prg_discard = 0;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(ts->pools); i++)
+        av_buffer_pool_uninit(&ts->pools[i]);
 
     for (i = 0; i < NB_PID_MAX; i++)
         if (ts->pids[i])
@@ -3125,13 +3224,16 @@ int avpriv_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
 
     len1 = len;
     ts->pkt = pkt;
+    update_discard_cache(ts);
     for (;;) {
         ts->stop_parse = 0;
         if (len < TS_PACKET_SIZE)
             return AVERROR_INVALIDDATA;
         if (buf[0] != 0x47) {
-            buf++;
-            len--;
+            const uint8_t *sync = memchr(buf, 0x47, len);
+            int skip = sync ? sync - buf : len;
+            buf += skip;
+            len -= skip;
         } else {
             handle_packet(ts, buf);
             buf += TS_PACKET_SIZE;
@@ -0,0 +1,172 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Check which requests of the http protocol with reuse_connections=1 share
+ * a connection, using a minimal keep-alive server on the loopback interface.
+ */
+
+#include "libavutil/dict.h"
+#include "libavutil/thread.h"
+#include "libavformat/avformat.h"
+#include "libavformat/http.h"
+#include "libavformat/network.h"
+
+#define MAX_CLIENTS 8
+
+static const char response[] = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+
+static int listen_fd;
+static int nb_connections;
+static int quit;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *server(void *arg)
+{
+    struct pollfd fds[MAX_CLIENTS + 1] = { { 0 } };
+    char bufs[MAX_CLIENTS][1024];
+    int lens[MAX_CLIENTS] = { 0 };
+    int i, n;
+
+    fds[0].fd     = listen_fd;
+    fds[0].events = POLLIN;
+    for (i = 1; i <= MAX_CLIENTS; i++)
+        fds[i].fd = -1;
+
+    for (;;) {
+        pthread_mutex_lock(&lock);
+        n = quit;
+        pthread_mutex_unlock(&lock);
+        if (n)
+            break;
+        if (poll(fds, MAX_CLIENTS + 1, 10) <= 0)
+            continue;
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            for (i = 1; i <= MAX_CLIENTS && fds[i].fd >= 0; i++);
+            if (fd >= 0 && i <= MAX_CLIENTS) {
+                fds[i].fd     = fd;
+                fds[i].events = POLLIN;
+                lens[i - 1]   = 0;
+                pthread_mutex_lock(&lock);
+                nb_connections++;
+                pthread_mutex_unlock(&lock);
+            } else if (fd >= 0) {
+                closesocket(fd);
+            }
+        }
+
+        for (i = 1; i <= MAX_CLIENTS; i++) {
+            char *buf = bufs[i - 1], *end;
+            if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            n = recv(fds[i].fd, buf + lens[i - 1], sizeof(bufs[0]) - 1 - lens[i - 1], 0);
+            if (n <= 0) {
+                closesocket(fds[i].fd);
+                fds[i].fd = -1;
+                continue;
+            }
+            lens[i - 1] += n;
+            buf[lens[i - 1]] = '\0';
+            /* Answer every complete request header. */
+            while ((end = strstr(buf, "\r\n\r\n"))) {
+                send(fds[i].fd, response, sizeof(response) - 1, 0);
+                lens[i - 1] -= end + 4 - buf;
+                memmove(buf, end + 4, lens[i - 1] + 1);
+            }
+        }
+    }
+
+    for (i = 1; i <= MAX_CLIENTS; i++)
+        if (fds[i].fd >= 0)
+            closesocket(fds[i].fd);
+    return NULL;
+}
+
+static void fetch(const char *name, const char *url, const char *options)
+{
+    AVIOContext *pb = NULL;
+    AVDictionary *opts = NULL;
+    char body[16] = { 0 };
+    int ret;
+
+    av_dict_parse_string(&opts, options, "=", ":", 0);
+    ret = avio_open2(&pb, url, AVIO_FLAG_READ, NULL, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        printf("%-28s open failed\n", name);
+        return;
+    }
+    avio_read(pb, body, sizeof(body) - 1);
+    avio_closep(&pb);
+
+    pthread_mutex_lock(&lock);
+    printf("%-28s %s, connections: %d\n", name, body, nb_connections);
+    pthread_mutex_unlock(&lock);
+}
+
+int main(void)
+{
+    struct sockaddr_in addr = { 0 };
+    socklen_t addr_len = sizeof(addr);
+    pthread_t thread;
+    char url[64];
+
+    avformat_network_init();
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listen_fd < 0 ||
+        bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+        listen(listen_fd, MAX_CLIENTS) ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len)) {
+        fprintf(stderr, "Cannot listen on the loopback interface\n");
+        return 1;
+    }
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/", ntohs(addr.sin_port));
+
+    if (pthread_create(&thread, NULL, server, NULL))
+        return 1;
+
+    fetch("first request",         url, "reuse_connections=1");
+    fetch("same options",          url, "reuse_connections=1");
+    fetch("different rw_timeout",  url, "reuse_connections=1:rw_timeout=5000000");
+    fetch("different tcp option",  url, "reuse_connections=1:tcp_nodelay=1");
+    fetch("same options again",    url, "reuse_connections=1");
+    fetch("tcp not whitelisted",   url, "reuse_connections=1:protocol_whitelist=http");
+    fetch("tcp blacklisted",       url, "reuse_connections=1:protocol_blacklist=tcp");
+    fetch("no reuse",              url, "");
+    ff_http_pool_flush();
+    fetch("after flush",           url, "reuse_connections=1");
+    fetch("pool size 0",           url, "reuse_connections=1:pool_size=0");
+    fetch("after pool size 0",     url, "reuse_connections=1");
+    fetch("pool size 1",           url, "reuse_connections=1:pool_size=1:rw_timeout=5000000");
+    fetch("evicted by pool size",  url, "reuse_connections=1");
+
+    avformat_network_deinit();
+
+    pthread_mutex_lock(&lock);
+    quit = 1;
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread, NULL);
+    closesocket(listen_fd);
+
+    return 0;
+}
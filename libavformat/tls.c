@@ -108,3 +108,14 @@ int ff_tls_open_underlying(TLSShared *c, URLContext *parent, const char *uri, AV
                                 &parent->interrupt_callback, options,
                                 parent->protocol_whitelist, parent->protocol_blacklist, parent);
 }
+
+URLContext *ff_tls_get_underlying(URLContext *h)
+{
+    /* Every TLS backend starts its private context with these fields. */
+    const struct {
+        const AVClass *class;
+        TLSShared tls_shared;
+    } *c = h->priv_data;
+
+    return c->tls_shared.tcp;
+}
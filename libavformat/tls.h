@@ -53,6 +53,11 @@ typedef struct TLSShared {
 
 int ff_tls_open_underlying(TLSShared *c, URLContext *parent, const char *uri, AVDictionary **options);
 
+/**
+ * Return the TCP connection underlying an opened tls URLContext, or NULL.
+ */
+URLContext *ff_tls_get_underlying(URLContext *h);
+
 void ff_gnutls_init(void);
 void ff_gnutls_deinit(void);
 
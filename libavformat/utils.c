@@ -45,6 +45,7 @@
 #include "avformat.h"
 #include "avio_internal.h"
 #include "id3v2.h"
+#include "http.h"
 #include "internal.h"
 #include "metadata.h"
 #if CONFIG_NETWORK
@@ -5005,6 +5006,9 @@ int avformat_network_init(void)
 int avformat_network_deinit(void)
 {
 #if CONFIG_NETWORK
+#if CONFIG_HTTP_PROTOCOL
+    ff_http_pool_flush();
+#endif
     ff_network_close();
     ff_tls_deinit();
 #endif
@@ -154,6 +154,30 @@ static int strmatch(const char *s, const char *prefix)
     return !IS_IDENTIFIER_CHAR(s[i]);
 }
 
+typedef union ExprArg {
+    int const_index;
+    double (*func0)(double);
+    double (*func1)(void *, double);
+    double (*func2)(void *, double, double);
+} ExprArg;
+
+/**
+ * One instruction of the compiled form of an expression. It applies the
+ * operation of the tree node it was generated from to the registers src
+ * and stores the result in register dst, for a whole block of evaluations.
+ */
+typedef struct ExprInsn {
+    int type;
+    int dst;
+    int src[3];     ///< -1 for absent optional parameters
+    double value;
+    ExprArg a;
+} ExprInsn;
+
+#define EXPR_MAX_REGS   16
+#define EXPR_BLOCK      32
+#define EXPR_MAX_CONSTS 64  ///< constants copied on the stack by av_expr_eval_array()
+
 struct AVExpr {
     enum {
         e_value, e_const, e_func0, e_func1, e_func2,
@@ -165,14 +189,15 @@ struct AVExpr {
         e_if, e_ifnot, e_print, e_bitand, e_bitor, e_between, e_clip, e_atan2, e_lerp,
     } type;
     double value; // is sign in other types
-    union {
-        int const_index;
-        double (*func0)(double);
-        double (*func1)(void *, double);
-        double (*func2)(void *, double, double);
-    } a;
+    ExprArg a;
+    int func_index;
     struct AVExpr *param[3];
     double *var;
+    /* flat bytecode of the whole expression, only set on the root node */
+    ExprInsn *code;
+    int nb_code;
+    int nb_regs;
+    int nb_consts;
 };
 
 static double etime(double v)
@@ -338,6 +363,7 @@ void av_expr_free(AVExpr *e)
     av_expr_free(e->param[1]);
     av_expr_free(e->param[2]);
     av_freep(&e->var);
+    av_freep(&e->code);
     av_freep(&e);
 }
 
@@ -474,6 +500,7 @@ static int parse_primary(AVExpr **e, Parser *p)
         for (i=0; p->func1_names && p->func1_names[i]; i++) {
             if (strmatch(next, p->func1_names[i])) {
                 d->a.func1 = p->funcs1[i];
+                d->func_index = i;
                 d->type = e_func1;
                 *e = d;
                 return 0;
@@ -483,6 +510,7 @@ static int parse_primary(AVExpr **e, Parser *p)
         for (i=0; p->func2_names && p->func2_names[i]; i++) {
             if (strmatch(next, p->func2_names[i])) {
                 d->a.func2 = p->funcs2[i];
+                d->func_index = i;
                 d->type = e_func2;
                 *e = d;
                 return 0;
@@ -676,6 +704,120 @@ static int verify_expr(AVExpr *e)
     }
 }
 
+/**
+ * Replace the subexpressions which only depend on constant numbers by their
+ * value, so that they are not evaluated again on every av_expr_eval().
+ */
+static void fold_constants(AVExpr *e)
+{
+    Parser p = { 0 };
+    double d;
+    int i;
+
+    if (!e)
+        return;
+    for (i = 0; i < 3; i++)
+        fold_constants(e->param[i]);
+
+    switch (e->type) {
+    case e_value:
+    case e_const:
+    case e_func1:
+    case e_func2:
+    case e_ld:
+    case e_st:
+    case e_random:
+    case e_print:
+    case e_while:
+    case e_taylor:
+    case e_root:
+        return;
+    case e_func0:
+        if (e->a.func0 == etime)
+            return;
+        break;
+    default:
+        break;
+    }
+    for (i = 0; i < 3; i++)
+        if (e->param[i] && e->param[i]->type != e_value)
+            return;
+
+    d = eval_expr(&p, e);
+    for (i = 0; i < 3; i++) {
+        av_expr_free(e->param[i]);
+        e->param[i] = NULL;
+    }
+    e->type  = e_value;
+    e->value = d;
+}
+
+static int count_nodes(const AVExpr *e)
+{
+    if (!e)
+        return 0;
+    return 1 + count_nodes(e->param[0]) + count_nodes(e->param[1]) + count_nodes(e->param[2]);
+}
+
+/**
+ * Append the instructions computing e into register reg to the code of root.
+ * Parameter i of a node is computed into register reg + i.
+ *
+ * @return 0 on success, a negative value if e cannot be compiled
+ */
+static int compile_expr(AVExpr *root, const AVExpr *e, int reg)
+{
+    ExprInsn *insn;
+    int i, ret;
+
+    if (reg >= EXPR_MAX_REGS)
+        return AVERROR(ENOSYS);
+
+    switch (e->type) {
+    /* these depend on or modify the variables, or loop */
+    case e_ld:
+    case e_st:
+    case e_random:
+    case e_print:
+    case e_while:
+    case e_taylor:
+    case e_root:
+        return AVERROR(ENOSYS);
+    default:
+        break;
+    }
+
+    for (i = 0; i < 3; i++)
+        if (e->param[i] && (ret = compile_expr(root, e->param[i], reg + i)) < 0)
+            return ret;
+
+    insn = &root->code[root->nb_code++];
+    insn->type  = e->type;
+    insn->dst   = reg;
+    insn->value = e->value;
+    insn->a     = e->a;
+    for (i = 0; i < 3; i++)
+        insn->src[i] = e->param[i] ? reg + i : -1;
+    root->nb_regs = FFMAX(root->nb_regs, reg + 1);
+    return 0;
+}
+
+/**
+ * Try to build the bytecode used by av_expr_eval_array(). Expressions which
+ * cannot be compiled are evaluated with the tree walker instead.
+ */
+static int compile_code(AVExpr *e)
+{
+    e->code = av_malloc_array(count_nodes(e), sizeof(*e->code));
+    if (!e->code)
+        return AVERROR(ENOMEM);
+    if (compile_expr(e, e, 0) < 0) {
+        av_freep(&e->code);
+        e->nb_code = e->nb_regs = 0;
+    }
+    return 0;
+}
+
 int av_expr_parse(AVExpr **expr, const char *s,
                   const char * const *const_names,
                   const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -718,6 +860,11 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(EINVAL);
         goto end;
     }
+    fold_constants(e);
+    if ((ret = compile_code(e)) < 0)
+        goto end;
+    for (e->nb_consts = 0; const_names && const_names[e->nb_consts]; e->nb_consts++)
+        ;
     e->var= av_mallocz(sizeof(double) *VARS);
     if (!e->var) {
         ret = AVERROR(ENOMEM);
@@ -741,6 +888,137 @@ double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
     return eval_expr(&p, e);
 }
 
+#define LOOP(op) for (i = 0; i < n; i++) { op; } break
+
+static void run_code(const AVExpr *e, double (*r)[EXPR_BLOCK], int n, int offset,
+                     const double *const_values, const double * const *const_arrays,
+                     void *opaque)
+{
+    int i, k;
+
+    for (k = 0; k < e->nb_code; k++) {
+        const ExprInsn *c = &e->code[k];
+        const double v = c->value;
+        double *d = r[c->dst];
+        const double *a = r[FFMAX(c->src[0], 0)];
+        const double *b = r[FFMAX(c->src[1], 0)];
+        const double *x = r[FFMAX(c->src[2], 0)];
+
+        switch (c->type) {
+        case e_value:  LOOP(d[i] = v);
+        case e_const: {
+            const int idx = c->a.const_index;
+            if (const_arrays && const_arrays[idx]) {
+                const double *src = const_arrays[idx] + offset;
+                LOOP(d[i] = v * src[i]);
+            } else {
+                LOOP(d[i] = v * const_values[idx]);
+            }
+        }
+        case e_func0:  LOOP(d[i] = v * c->a.func0(a[i]));
+        case e_func1:  LOOP(d[i] = v * c->a.func1(opaque, a[i]));
+        case e_func2:  LOOP(d[i] = v * c->a.func2(opaque, a[i], b[i]));
+        case e_squish: LOOP(d[i] = 1/(1+exp(4*a[i])));
+        case e_gauss:  LOOP(d[i] = exp(-a[i]*a[i]/2)/sqrt(2*M_PI));
+        case e_isnan:  LOOP(d[i] = v * !!isnan(a[i]));
+        case e_isinf:  LOOP(d[i] = v * !!isinf(a[i]));
+        case e_floor:  LOOP(d[i] = v * floor(a[i]));
+        case e_ceil :  LOOP(d[i] = v * ceil (a[i]));
+        case e_trunc:  LOOP(d[i] = v * trunc(a[i]));
+        case e_round:  LOOP(d[i] = v * round(a[i]));
+        case e_sqrt:   LOOP(d[i] = v * sqrt (a[i]));
+        case e_not:    LOOP(d[i] = v * (a[i] == 0));
+        case e_if:     LOOP(d[i] = v * ( a[i] ? b[i] : c->src[2] >= 0 ? x[i] : 0));
+        case e_ifnot:  LOOP(d[i] = v * (!a[i] ? b[i] : c->src[2] >= 0 ? x[i] : 0));
+        case e_clip:
+            LOOP(d[i] = isnan(b[i]) || isnan(x[i]) || isnan(a[i]) || b[i] > x[i] ?
+                        NAN : v * av_clipd(a[i], b[i], x[i]));
+        case e_between: LOOP(d[i] = v * (a[i] >= b[i] && a[i] <= x[i]));
+        case e_lerp:   LOOP(d[i] = a[i] + (b[i] - a[i]) * x[i]);
+        case e_mod:    LOOP(d[i] = v * (a[i] - floor((!CONFIG_FTRAPV || b[i]) ? a[i] / b[i] : a[i] * INFINITY) * b[i]));
+        case e_gcd:    LOOP(d[i] = v * av_gcd(a[i], b[i]));
+        case e_max:    LOOP(d[i] = v * (a[i] >  b[i] ? a[i] : b[i]));
+        case e_min:    LOOP(d[i] = v * (a[i] <  b[i] ? a[i] : b[i]));
+        case e_eq:     LOOP(d[i] = v * (a[i] == b[i] ? 1.0 : 0.0));
+        case e_gt:     LOOP(d[i] = v * (a[i] >  b[i] ? 1.0 : 0.0));
+        case e_gte:    LOOP(d[i] = v * (a[i] >= b[i] ? 1.0 : 0.0));
+        case e_lt:     LOOP(d[i] = v * (a[i] <  b[i] ? 1.0 : 0.0));
+        case e_lte:    LOOP(d[i] = v * (a[i] <= b[i] ? 1.0 : 0.0));
+        case e_pow:    LOOP(d[i] = v * pow(a[i], b[i]));
+        case e_mul:    LOOP(d[i] = v * (a[i] * b[i]));
+        case e_div:    LOOP(d[i] = v * ((!CONFIG_FTRAPV || b[i]) ? (a[i] / b[i]) : a[i] * INFINITY));
+        case e_add:    LOOP(d[i] = v * (a[i] + b[i]));
+        case e_last:   LOOP(d[i] = v * b[i]);
+        case e_hypot:  LOOP(d[i] = v * hypot(a[i], b[i]));
+        case e_atan2:  LOOP(d[i] = v * atan2(a[i], b[i]));
+        case e_bitand: LOOP(d[i] = isnan(a[i]) || isnan(b[i]) ? NAN : v * ((long int)a[i] & (long int)b[i]));
+        case e_bitor:  LOOP(d[i] = isnan(a[i]) || isnan(b[i]) ? NAN : v * ((long int)a[i] | (long int)b[i]));
+        default:       LOOP(d[i] = NAN);
+        }
+    }
+}
+#undef LOOP
+
+int av_expr_eval_array(AVExpr *e, double *res, int nb,
+                       const double *const_values,
+                       const double * const *const_arrays, void *opaque)
+{
+    double regs[EXPR_MAX_REGS][EXPR_BLOCK];
+    double stack_values[EXPR_MAX_CONSTS];
+    double *values = stack_values;
+    int i, j;
+
+    if (e->code) {
+        for (i = 0; i < nb; i += EXPR_BLOCK) {
+            const int n = FFMIN(nb - i, EXPR_BLOCK);
+            run_code(e, regs, n, i, const_values, const_arrays, opaque);
+            memcpy(res + i, regs[0], n * sizeof(*res));
+        }
+        return 0;
+    }
+
+    /* the expression may be shared between threads, so the per-element
+     * constants go on the stack unless there are unusually many of them */
+    if (e->nb_consts > EXPR_MAX_CONSTS) {
+        values = av_malloc_array(e->nb_consts, sizeof(*values));
+        if (!values)
+            return AVERROR(ENOMEM);
+    }
+    if (e->nb_consts)
+        memcpy(values, const_values, e->nb_consts * sizeof(*values));
+    for (i = 0; i < nb; i++) {
+        for (j = 0; j < e->nb_consts; j++)
+            if (const_arrays && const_arrays[j])
+                values[j] = const_arrays[j][i];
+        res[i] = av_expr_eval(e, values, opaque);
+    }
+    if (values != stack_values)
+        av_free(values);
+    return 0;
+}
+
+static int expr_count(AVExpr *e, unsigned *counter, int size, int type)
+{
+    int i;
+
+    if (!e || !counter || !size)
+        return AVERROR(EINVAL);
+
+    for (i = 0; i < 3 && e->param[i]; i++)
+        expr_count(e->param[i], counter, size, type);
+    if (e->type == type && e->func_index < size)
+        counter[e->func_index]++;
+
+    return 0;
+}
+
+int av_expr_count_func(AVExpr *e, unsigned *counter, int size, int arg)
+{
+    if (arg != 1 && arg != 2)
+        return AVERROR(EINVAL);
+    return expr_count(e, counter, size, arg == 1 ? e_func1 : e_func2);
+}
+
 int av_expr_parse_and_eval(double *d, const char *s,
                            const char * const *const_names, const double *const_values,
                            const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -86,6 +86,45 @@ int av_expr_parse(AVExpr **expr, const char *s,
  */
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque);
 
+/**
+ * Evaluate a previously parsed expression for several sets of values.
+ *
+ * This gives the same results as calling av_expr_eval() nb times, but
+ * amortizes the evaluation overhead over the whole array, which makes it
+ * considerably faster for expressions evaluated per pixel or per sample.
+ *
+ * The functions from funcs1 and funcs2 may be called in a different order,
+ * and also for branches of if() and similar whose result is not used, so
+ * they must only depend on their arguments and on opaque.
+ *
+ * @param res array where the nb results are stored
+ * @param nb number of evaluations
+ * @param const_values a zero terminated array of values for the identifiers from av_expr_parse() const_names
+ * @param const_arrays NULL, or an array with one entry per identifier from
+ *                     const_names; a non-NULL entry points to nb values which
+ *                     are used instead of the corresponding const_values entry,
+ *                     one for each evaluation
+ * @param opaque a pointer which will be passed to all functions from funcs1 and funcs2
+ * @return >= 0 in case of success, a negative value corresponding to an
+ * AVERROR code otherwise
+ */
+int av_expr_eval_array(AVExpr *e, double *res, int nb,
+                       const double *const_values,
+                       const double * const *const_arrays, void *opaque);
+
+/**
+ * Track the presence of user provided functions and their number of occurrences
+ * in a parsed expression.
+ *
+ * @param counter a zero-initialized array where the count of each function will be stored,
+ *                in the order of the funcs1 or funcs2 arrays passed to av_expr_parse()
+ * @param size size of the array
+ * @param arg number of arguments of the counted functions, 1 for funcs1 and 2 for funcs2
+ * @return 0 on success, a negative value indicates that no expression or array was passed
+ * or size was zero
+ */
+int av_expr_count_func(AVExpr *e, unsigned *counter, int size, int arg);
+
 /**
  * Free a parsed expression previously created with av_expr_parse().
  */
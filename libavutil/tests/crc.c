@@ -19,13 +19,42 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "libavutil/common.h"
 #include "libavutil/crc.h"
+#include "libavutil/lfg.h"
+
+/* one byte at a time, as a reference for the table driven code */
+static uint32_t crc_ref(const AVCRC *ctx, uint32_t crc, const uint8_t *buf, size_t len)
+{
+    while (len--)
+        crc = ctx[(uint8_t)crc ^ *buf++] ^ (crc >> 8);
+    return crc;
+}
+
+static void check_lengths(const AVCRC *ctx, unsigned poly, const uint8_t *buf, AVLFG *lfg)
+{
+    int len, offset, errors = 0;
+
+    for (len = 0; len < 600; len++) {
+        for (offset = 0; offset < 16; offset += 5) {
+            uint32_t crc  = av_lfg_get(lfg);
+            uint32_t ref  = crc_ref(ctx, crc, buf + offset, len);
+            int split     = len ? av_lfg_get(lfg) % len : 0;
+
+            if (av_crc(ctx, crc, buf + offset, len) != ref ||
+                av_crc(ctx, av_crc(ctx, crc, buf + offset, split),
+                       buf + offset + split, len - split) != ref)
+                errors++;
+        }
+    }
+    printf("crc %08X lengths: %s\n", poly, errors ? "FAIL" : "OK");
+}
 
 int main(void)
 {
     uint8_t buf[1999];
     int i;
-    static const unsigned p[7][3] = {
+    static const unsigned p[8][3] = {
         { AV_CRC_32_IEEE_LE, 0xEDB88320, 0x3D5CDD04 },
         { AV_CRC_32_IEEE   , 0x04C11DB7, 0xC0F5BAE0 },
         { AV_CRC_24_IEEE   , 0x864CFB  , 0xB704CE   },
@@ -33,15 +62,22 @@ int main(void)
         { AV_CRC_16_ANSI   , 0x8005    , 0x1FBB     },
         { AV_CRC_8_ATM     , 0x07      , 0xE3       },
         { AV_CRC_8_EBU     , 0x1D      , 0xD6       },
+        { AV_CRC_16_CCITT  , 0x1021    , 0x6C20     },
     };
     const AVCRC *ctx;
+    AVLFG lfg;
 
     for (i = 0; i < sizeof(buf); i++)
         buf[i] = i + i * i;
 
-    for (i = 0; i < 7; i++) {
+    for (i = 0; i < FF_ARRAY_ELEMS(p); i++) {
         ctx = av_crc_get_table(p[i][0]);
         printf("crc %08X = %X\n", p[i][1], av_crc(ctx, 0, buf, sizeof(buf)));
     }
+
+    av_lfg_init(&lfg, 0xC4C);
+    for (i = 0; i < FF_ARRAY_ELEMS(p); i++)
+        check_lengths(av_crc_get_table(p[i][0]), p[i][1], buf, &lfg);
+
     return 0;
 }
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "libavutil/common.h"
 #include "libavutil/libm.h"
 #include "libavutil/eval.h"
 
@@ -37,6 +38,73 @@ static const char *const const_names[] = {
     0
 };
 
+static const char *const array_const_names[] = {
+    "X",
+    "Y",
+    0
+};
+
+static double array_func1(void *opaque, double x)
+{
+    return x * *(double *)opaque;
+}
+
+static double (* const array_funcs1[])(void *, double) = { array_func1, NULL };
+static const char *const array_func1_names[] = { "f", NULL };
+
+static void test_eval_array(void)
+{
+    static const char *const exprs[] = {
+        "X",
+        "-X*Y+3*2",
+        "sin(X)*cos(Y/3)-exp(-X*X)",
+        "mod(X,3)+max(X,Y)-min(X,-Y)+eq(X,Y)+gt(X,0)+gte(X,1)+lt(X,2)+lte(X,3)",
+        "if(gt(X,0), f(X), -f(Y))+ifnot(X, 5)+if(Y, 1)",
+        "clip(X, -3, Y)+between(X, -1, 2)+lerp(X, Y, 0.25)",
+        "squish(X)+gauss(Y)+isnan(sqrt(X))+isinf(1/X)+not(X)",
+        "floor(X/3)+ceil(X/3)+trunc(X/3)+round(X/3)+abs(X)^1.5",
+        "hypot(X, Y)+atan2(X, Y)+gcd(X, 12)+bitand(X, 6)+bitor(X, 9)",
+        "X;Y*2",
+        "st(0, ld(0)+X); ld(0)",
+        "1+(5-2)^(3-1)+1/2+sin(PI)",
+        NULL
+    };
+    double x[100], y[100], res[100];
+    const double *arrays[] = { x, NULL };
+    double values[] = { 0, 7, 0 };
+    double factor = 2;
+    int i, j;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(x); i++)
+        x[i] = (i - 50) * 0.25;
+
+    for (i = 0; exprs[i]; i++) {
+        AVExpr *e0 = NULL, *e1 = NULL;
+        int mismatch = 0;
+
+        if (av_expr_parse(&e0, exprs[i], array_const_names,
+                          array_func1_names, array_funcs1, NULL, NULL, 0, NULL) < 0 ||
+            av_expr_parse(&e1, exprs[i], array_const_names,
+                          array_func1_names, array_funcs1, NULL, NULL, 0, NULL) < 0) {
+            printf("av_expr_parse failed for '%s'\n", exprs[i]);
+            continue;
+        }
+        for (j = 0; j < FF_ARRAY_ELEMS(x); j++) {
+            values[0] = x[j];
+            y[j] = av_expr_eval(e0, values, &factor);
+        }
+        if (av_expr_eval_array(e1, res, FF_ARRAY_ELEMS(x), values, arrays, &factor) < 0)
+            printf("av_expr_eval_array failed\n");
+        for (j = 0; j < FF_ARRAY_ELEMS(x); j++)
+            if (y[j] != res[j] && !(isnan(y[j]) && isnan(res[j])))
+                mismatch++;
+        printf("'%s' array -> %s\n", exprs[i], mismatch ? "mismatch" : "ok");
+        av_expr_free(e0);
+        av_expr_free(e1);
+    }
+    printf("\n");
+}
+
 int main(int argc, char **argv)
 {
     int i;
@@ -155,6 +223,8 @@ int main(int argc, char **argv)
             printf("av_expr_parse_and_eval failed\n");
     }
 
+    test_eval_array();
+
     ret = av_expr_parse_and_eval(&d, "1+(5-2)^(3-1)+1/2+sin(PI)-max(-2.2,-3.1)",
                            const_names, const_values,
                            NULL, NULL, NULL, NULL, NULL, 0, NULL);
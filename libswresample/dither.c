@@ -112,6 +112,7 @@ av_cold int swri_dither_init(SwrContext *s, enum AVSampleFormat out_fmt, enum AV
     s->dither.ns_scale   =   scale;
     s->dither.ns_scale_1 = scale ? 1/scale : 0;
     memset(s->dither.ns_errors, 0, sizeof(s->dither.ns_errors));
+    memset(s->dither.ns_coeffs, 0, sizeof(s->dither.ns_coeffs));
     for (i=0; filters[i].coefs; i++) {
         const filter_t *f = &filters[i];
         if (llabs(s->out_sample_rate - f->rate)*20 <= f->rate && f->name == s->dither.method) {
@@ -86,6 +86,10 @@ static const AVOption options[]={
 {"phase_shift"          , "set swr resampling phase shift", OFFSET(phase_shift)  , AV_OPT_TYPE_INT  , {.i64=10                    }, 0      , 24        , PARAM },
 {"linear_interp"        , "enable linear interpolation" , OFFSET(linear_interp)  , AV_OPT_TYPE_BOOL , {.i64=1                     }, 0      , 1         , PARAM },
 {"exact_rational"       , "enable exact rational"       , OFFSET(exact_rational) , AV_OPT_TYPE_BOOL , {.i64=1                     }, 0      , 1         , PARAM },
+{"resample_threads"     , "set number of threads resampling the channels", OFFSET(nb_threads), AV_OPT_TYPE_INT, {.i64=1            }, 0      , INT_MAX   , PARAM, "resample_threads"},
+    {"auto"             , "autodetect a suitable number of threads", 0        , AV_OPT_TYPE_CONST, {.i64=0                     }, INT_MIN, INT_MAX   , PARAM, "resample_threads"},
+{"block_size"           , "set maximum input samples per swr_convert_block() call, enabling the fixed delay block mode"
+                                                        , OFFSET(block_size)     , AV_OPT_TYPE_INT  , {.i64=0                     }, 0      , INT_MAX/4 , PARAM },
 {"cutoff"               , "set cutoff frequency ratio"  , OFFSET(cutoff)         , AV_OPT_TYPE_DOUBLE,{.dbl=0.                    }, 0      , 1         , PARAM },
 
 /* duplicate option in order to work with avconv */
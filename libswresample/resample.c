@@ -281,9 +281,57 @@ static void resample_free(ResampleContext **cc){
     if(!c)
         return;
     av_freep(&c->filter_bank);
+    avpriv_slicethread_free(&c->slicethread);
     av_freep(cc);
 }
 
+static void resample_channels(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ResampleContext *c = priv;
+    int ch_count = c->thread_dst->ch_count;
+    int start = (ch_count *  jobnr     ) / nb_jobs;
+    int end   = (ch_count * (jobnr + 1)) / nb_jobs;
+    int i;
+
+    for (i = start; i < end; i++) {
+        if (i + 1 == ch_count) {
+            /* the last channel updates the position, on a private copy as
+             * the other jobs may still be reading it */
+            ResampleContext tmp = *c;
+            c->thread_consumed = c->thread_func(&tmp, c->thread_dst->ch[i], c->thread_src->ch[i],
+                                                c->thread_dst_size, 1);
+            c->thread_index = tmp.index;
+            c->thread_frac  = tmp.frac;
+        } else
+            c->thread_func(c, c->thread_dst->ch[i], c->thread_src->ch[i], c->thread_dst_size, 0);
+    }
+
+    if (c->thread_need_emms)
+        emms_c();
+}
+
+int swri_resample_init_threads(ResampleContext *c, int nb_threads)
+{
+    int ret;
+
+    if (c->slicethread && c->nb_threads == nb_threads)
+        return 0;
+
+    avpriv_slicethread_free(&c->slicethread);
+    if (!HAVE_THREADS || nb_threads == 1)
+        return 0;
+
+    ret = avpriv_slicethread_create(&c->slicethread, c, resample_channels, NULL, nb_threads);
+    if (ret < 0)
+        return ret;
+    if (ret <= 1)
+        avpriv_slicethread_free(&c->slicethread);
+    c->nb_threads   = nb_threads;
+    c->thread_count = ret;
+
+    return 0;
+}
+
 static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff0, enum AVSampleFormat format, enum SwrFilterType filter_type, double kaiser_beta,
                                     double precision, int cheby, int exact_rational)
@@ -449,6 +497,33 @@ static int set_compensation(ResampleContext *c, int sample_delta, int compensati
     return 0;
 }
 
+static int resample_planes(ResampleContext *c,
+                           int (*resample_func)(struct ResampleContext *c, void *dst,
+                                                const void *src, int n, int update_ctx),
+                           AudioData *dst, AudioData *src, int dst_size, int need_emms)
+{
+    int i, consumed = 0;
+
+    if (c->slicethread && dst->ch_count > 1) {
+        c->thread_func      = resample_func;
+        c->thread_dst       = dst;
+        c->thread_src       = src;
+        c->thread_dst_size  = dst_size;
+        c->thread_need_emms = need_emms;
+        /* contiguous groups of channels, one per thread */
+        avpriv_slicethread_execute(c->slicethread,
+                                   FFMIN(dst->ch_count, c->thread_count), 0);
+        c->index = c->thread_index;
+        c->frac  = c->thread_frac;
+        consumed = c->thread_consumed;
+    } else {
+        for (i = 0; i < dst->ch_count; i++)
+            consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+    }
+
+    return consumed;
+}
+
 static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
     int i;
     int av_unused mm_flags = av_get_cpu_flags();
@@ -494,8 +569,7 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
              * when frac and dst_incr_mod are zero */
             resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
                             c->dsp.resample_linear : c->dsp.resample_common;
-            for (i = 0; i < dst->ch_count; i++)
-                *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            *consumed = resample_planes(c, resample_func, dst, src, dst_size, need_emms);
         }
     }
 
@@ -514,6 +588,82 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
     return dst_size;
 }
 
+int swri_resample_init_block(ResampleContext *c)
+{
+    /* the first output sample is centered filter_length / 2 samples into
+     * the zeroed history, which gives the block mode its fixed delay */
+    c->index = 0;
+    c->frac  = 0;
+
+    return c->filter_length - 1;
+}
+
+int64_t swri_resample_block_out_samples(ResampleContext *c, int in_samples)
+{
+    int64_t end = (int64_t)in_samples * c->phase_count * c->src_incr;
+    int64_t pos = (int64_t)c->index * c->src_incr + c->frac;
+
+    if (end <= pos)
+        return 0;
+    return (end - pos + c->dst_incr - 1) / c->dst_incr;
+}
+
+int swri_resample_block(ResampleContext *c, AudioData *dst, int dst_size,
+                        const AudioData *src, int src_size)
+{
+    int av_unused mm_flags = av_get_cpu_flags();
+    int need_emms = c->format == AV_SAMPLE_FMT_S16P && ARCH_X86_32 &&
+                    (mm_flags & (AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE2)) == AV_CPU_FLAG_MMX2;
+    int64_t end = (int64_t)src_size * c->phase_count * c->src_incr;
+    int64_t pos = (int64_t)c->index * c->src_incr + c->frac;
+    int dst_incr = c->dst_incr;
+    int (*resample_func)(struct ResampleContext *c, void *dst,
+                         const void *src, int n, int update_ctx);
+    AudioData tmp = *src;
+    int ch, skip, consumed;
+
+    if (dst_size != swri_resample_block_out_samples(c, src_size)) {
+        /* spread dst_size samples evenly over the block, rounding the step
+         * up so that the next block starts at or after its first sample */
+        int64_t incr;
+
+        if (!dst_size || end <= pos)
+            return AVERROR(EINVAL);
+        incr = (end - pos + dst_size - 1) / dst_size;
+        if (incr > INT_MAX || pos + (dst_size - 1) * incr >= end)
+            return AVERROR(EINVAL);
+        c->dst_incr = incr;
+    }
+    c->dst_incr_div = c->dst_incr / c->src_incr;
+    c->dst_incr_mod = c->dst_incr % c->src_incr;
+
+    /* the SIMD versions expect index < phase_count */
+    skip      = c->index / c->phase_count;
+    c->index %= c->phase_count;
+    consumed  = skip;
+
+    if (dst_size > 0) {
+        for (ch = 0; ch < tmp.ch_count; ch++)
+            tmp.ch[ch] += skip * c->felem_size;
+
+        resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
+                        c->dsp.resample_linear : c->dsp.resample_common;
+        consumed += resample_planes(c, resample_func, dst, &tmp, dst_size, need_emms);
+        if (need_emms)
+            emms_c();
+    }
+
+    /* carry the position over, relative to the start of the next block */
+    c->index += (consumed - src_size) * c->phase_count;
+    av_assert2(c->index >= 0);
+
+    c->dst_incr     = dst_incr;
+    c->dst_incr_div = c->dst_incr / c->src_incr;
+    c->dst_incr_mod = c->dst_incr % c->src_incr;
+
+    return dst_size;
+}
+
 static int64_t get_delay(struct SwrContext *s, int64_t base){
     ResampleContext *c = s->resample;
     int64_t num = s->in_buffer_count - (c->filter_length-1)/2;
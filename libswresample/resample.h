@@ -24,6 +24,7 @@
 
 #include "libavutil/log.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/slicethread.h"
 
 #include "swresample_internal.h"
 
@@ -58,6 +59,17 @@ typedef struct ResampleContext {
         int (*resample_linear)(struct ResampleContext *c, void *dst,
                                const void *src, int n, int update_ctx);
     } dsp;
+
+    AVSliceThread *slicethread;
+    int nb_threads;                    /* requested thread count, 0 for auto */
+    int thread_count;                  /* threads actually running */
+    /* state of the channel jobs of the current multiple_resample() call */
+    int (*thread_func)(struct ResampleContext *c, void *dst,
+                       const void *src, int n, int update_ctx);
+    AudioData *thread_dst, *thread_src;
+    int thread_dst_size;
+    int thread_need_emms;
+    int thread_consumed, thread_index, thread_frac;
 } ResampleContext;
 
 void swri_resample_dsp_init(ResampleContext *c);
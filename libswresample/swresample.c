@@ -149,6 +149,52 @@ av_cold void swr_close(SwrContext *s){
     clear_context(s);
 }
 
+static int realloc_dither_noise(SwrContext *s, int count)
+{
+    int ch, ret;
+
+    if ((ret = swri_realloc_audio(&s->dither.noise, count)) <= 0)
+        return ret;
+    for (ch = 0; ch < s->dither.noise.ch_count; ch++)
+        if ((ret = swri_get_dither(s, s->dither.noise.ch[ch], s->dither.noise.count, (12345678913579ULL*ch + 3141592) % 2718281828U, s->dither.noise.fmt)) < 0)
+            return ret;
+    return 0;
+}
+
+/**
+ * Largest out_count accepted by swr_convert_block(): the output of a full
+ * block, rounded up, plus one sample of headroom for drift compensation.
+ */
+static int block_out_max(SwrContext *s)
+{
+    return av_rescale_rnd(s->block_size, s->out_sample_rate, s->in_sample_rate, AV_ROUND_UP) + 1;
+}
+
+/**
+ * Allocate all buffers used by swr_convert_block() upfront, so that no
+ * allocation happens while converting.
+ */
+static int alloc_block_buffers(SwrContext *s)
+{
+    int out_max = block_out_max(s);
+    int ret;
+
+    if (   (ret = swri_realloc_audio(&s->postin, s->block_size)) < 0
+        || (ret = swri_realloc_audio(&s->midbuf, s->resample_first ? out_max : s->block_size)) < 0
+        || (ret = swri_realloc_audio(&s->preout, out_max)) < 0)
+        return ret;
+    if (s->resample &&
+        (ret = swri_realloc_audio(&s->in_buffer, s->in_buffer_count + s->block_size)) < 0)
+        return ret;
+    if (s->dither.method) {
+        if ((ret = realloc_dither_noise(s, FFMAX(out_max, 1<<16))) < 0)
+            return ret;
+        if ((ret = swri_realloc_audio(&s->dither.temp, FFMAX(out_max, 1<<16))) < 0)
+            return ret;
+    }
+    return 0;
+}
+
 av_cold int swr_init(struct SwrContext *s){
     int ret;
     char l1[1024], l2[1024];
@@ -269,6 +315,19 @@ av_cold int swr_init(struct SwrContext *s){
             av_log(s, AV_LOG_ERROR, "Failed to initialize resampler\n");
             return AVERROR(ENOMEM);
         }
+        if (s->resampler == &swri_resampler &&
+            (ret = swri_resample_init_threads(s->resample, s->nb_threads)) < 0) {
+            av_log(s, AV_LOG_ERROR, "Failed to create resampling threads\n");
+            return ret;
+        }
+        if (s->block_size) {
+            if (s->resampler != &swri_resampler) {
+                av_log(s, AV_LOG_ERROR, "Block mode is only supported by the swr resampler\n");
+                return AVERROR(EINVAL);
+            }
+            /* in block mode in_buffer only holds the filter history */
+            s->in_buffer_count = swri_resample_init_block(s->resample);
+        }
     }else
         s->resampler->free(&s->resample);
     if(    s->int_sample_fmt != AV_SAMPLE_FMT_S16P
@@ -382,6 +441,9 @@ av_assert0(s->out.ch_count);
             goto fail;
     }
 
+    if (s->block_size && (ret = alloc_block_buffers(s)) < 0)
+        goto fail;
+
     return 0;
 fail:
     swr_close(s);
@@ -472,6 +534,27 @@ static void buf_set(AudioData *out, AudioData *in, int count){
     }
 }
 
+static int resample_block(SwrContext *s, AudioData *out, int out_count,
+                          AudioData *in, int in_count){
+    AudioData tmp;
+    int ch, ret;
+
+    tmp = s->in_buffer;
+    buf_set(&tmp, &s->in_buffer, s->in_buffer_count);
+    copy(&tmp, in, in_count);
+
+    ret = swri_resample_block(s->resample, out, out_count, &s->in_buffer, in_count);
+    if (ret < 0)
+        return ret;
+
+    // keep the last in_buffer_count samples as history for the next block
+    buf_set(&tmp, &s->in_buffer, in_count);
+    for (ch = 0; ch < s->in_buffer.ch_count; ch++)
+        memmove(s->in_buffer.ch[ch], tmp.ch[ch], s->in_buffer_count * s->in_buffer.bps);
+
+    return ret;
+}
+
 /**
  *
  * @return number of samples output per channel
@@ -487,6 +570,9 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
     av_assert1(s->in_buffer.planar   == in_param->planar);
     av_assert1(s->in_buffer.fmt      == in_param->fmt);
 
+    if (s->block_size)
+        return resample_block(s, out_param, out_count, (AudioData *)in_param, in_count);
+
     tmp=out=*out_param;
     in =  *in_param;
 
@@ -636,6 +722,8 @@ static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_co
     if(s->resample_first){
         if(postin != midbuf)
             out_count= resample(s, midbuf, out_count, postin, in_count);
+        if(out_count < 0)
+            return out_count;
         if(midbuf != preout)
             swri_rematrix(s, preout, midbuf, out_count, preout==out);
     }else{
@@ -643,6 +731,8 @@ static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_co
             swri_rematrix(s, midbuf, postin, in_count, midbuf==out);
         if(midbuf != preout)
             out_count= resample(s, preout, out_count, midbuf, in_count);
+        if(out_count < 0)
+            return out_count;
     }
 
     if(preout != out && out_count){
@@ -657,12 +747,8 @@ static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_co
                     return ret;
             }
 
-            if((ret=swri_realloc_audio(&s->dither.noise, dither_count))<0)
+            if((ret=realloc_dither_noise(s, dither_count))<0)
                 return ret;
-            if(ret)
-                for(ch=0; ch<s->dither.noise.ch_count; ch++)
-                    if((ret=swri_get_dither(s, s->dither.noise.ch[ch], s->dither.noise.count, (12345678913579ULL*ch + 3141592) % 2718281828U, s->dither.noise.fmt))<0)
-                        return ret;
             av_assert0(s->dither.noise.ch_count == preout->ch_count);
 
             if(s->dither.noise_pos + out_count > s->dither.noise.count)
@@ -713,6 +799,10 @@ int attribute_align_arg swr_convert(struct SwrContext *s, uint8_t *out_arg[SWR_C
         av_log(s, AV_LOG_ERROR, "Context has not been initialized\n");
         return AVERROR(EINVAL);
     }
+    if (s->block_size) {
+        av_log(s, AV_LOG_ERROR, "Context is in block mode, use swr_convert_block()\n");
+        return AVERROR(EINVAL);
+    }
 #if defined(ASSERT_LEVEL) && ASSERT_LEVEL >1
     max_output = swr_get_out_samples(s, in_count);
 #endif
@@ -817,6 +907,33 @@ int attribute_align_arg swr_convert(struct SwrContext *s, uint8_t *out_arg[SWR_C
     }
 }
 
+int swr_convert_block(struct SwrContext *s, uint8_t **out_arg, int out_count,
+                      const uint8_t **in_arg, int in_count){
+    AudioData * in= &s->in;
+    AudioData *out= &s->out;
+    int ret;
+
+    if (!swr_is_initialized(s) || !s->block_size) {
+        av_log(s, AV_LOG_ERROR, "Context has not been initialized in block mode\n");
+        return AVERROR(EINVAL);
+    }
+    if (!in_arg || !out_arg || in_count < 0 || in_count > s->block_size ||
+        out_count < 0 || out_count > block_out_max(s) ||
+        (!s->resample && out_count != in_count))
+        return AVERROR(EINVAL);
+    if (!in_count && !out_count)
+        return 0;
+
+    fill_audiodata(in ,  (void*)in_arg);
+    fill_audiodata(out, out_arg);
+
+    ret = swr_convert_internal(s, out, out_count, in, in_count);
+    if (ret > 0)
+        s->outpts += ret * (int64_t)s->in_sample_rate;
+
+    return ret;
+}
+
 int swr_drop_output(struct SwrContext *s, int count){
     const uint8_t *tmp_arg[SWR_CH_MAX];
     s->drop_output += count;
@@ -871,7 +988,9 @@ int swr_get_out_samples(struct SwrContext *s, int in_samples)
     if (in_samples < 0)
         return AVERROR(EINVAL);
 
-    if (s->resampler && s->resample) {
+    if (s->block_size && s->resample) {
+        out_samples = swri_resample_block_out_samples(s->resample, in_samples);
+    } else if (s->resampler && s->resample) {
         if (!s->resampler->get_out_samples)
             return AVERROR(ENOSYS);
         out_samples = s->resampler->get_out_samples(s, in_samples);
@@ -306,6 +306,37 @@ void swr_close(struct SwrContext *s);
 int swr_convert(struct SwrContext *s, uint8_t **out, int out_count,
                                 const uint8_t **in , int in_count);
 
+/**
+ * Convert a block of audio with a fixed delay.
+ *
+ * This requires the context to be initialized with the "block_size" option
+ * set to the largest in_count that will be passed. All buffers are then
+ * allocated by swr_init(), no input is buffered and the delay between input
+ * and output is fixed, as reported by swr_get_delay() after swr_init(). The
+ * resampling position is carried over from block to block with sub-sample
+ * precision. swr_convert() cannot be used on such a context; to drain it,
+ * feed it blocks of silence.
+ *
+ * Exactly in_count samples are consumed and exactly out_count samples are
+ * written. swr_get_out_samples() returns the exact number of samples that
+ * matches the nominal rates for the next block. If out_count differs from
+ * that, the resampling step is adjusted for this block so that out_count
+ * samples span it, which allows tracking a clock drift of the source. The
+ * cutoff frequency is not adjusted, so the deviation should be small.
+ *
+ * @param s         Swr context initialized with a non-zero block_size
+ * @param out       output buffers, only the first one need be set in case of packed audio
+ * @param out_count number of samples to output per channel, must be equal to
+ *                  in_count if no resampling is done, and at most one more
+ *                  than a block of block_size samples yields, rounded up
+ * @param in        input buffers, only the first one need to be set in case of packed audio
+ * @param in_count  number of input samples in one channel, at most block_size
+ *
+ * @return out_count on success, negative AVERROR code on error
+ */
+int swr_convert_block(struct SwrContext *s, uint8_t **out, int out_count,
+                      const uint8_t **in , int in_count);
+
 /**
  * Convert the next timestamp from input to output
  * timestamps are in 1/(in_sample_rate * out_sample_rate) units.
@@ -128,6 +128,8 @@ struct SwrContext {
     int phase_shift;                                /**< log2 of the number of entries in the resampling polyphase filterbank */
     int linear_interp;                              /**< if 1 then the resampling FIR filter will be linearly interpolated */
     int exact_rational;                             /**< if 1 then enable non power of 2 phase_count */
+    int nb_threads;                                 /**< swr: number of threads resampling the channels in parallel, 0 for auto */
+    int block_size;                                 /**< maximum input samples per swr_convert_block() call, 0 if block mode is disabled */
     double cutoff;                                  /**< resampling cutoff frequency (swr: 6dB point; soxr: 0dB point). 1.0 corresponds to half the output sample rate */
     int filter_type;                                /**< swr resampling filter type */
     double kaiser_beta;                                /**< swr beta value for Kaiser window (only applicable if filter_type == AV_FILTER_TYPE_KAISER) */
@@ -196,6 +198,12 @@ void swri_noise_shaping_float (SwrContext *s, AudioData *dsts, const AudioData *
 void swri_noise_shaping_double(SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 
 av_warn_unused_result
+int swri_resample_init_threads(struct ResampleContext *c, int nb_threads);
+int swri_resample_init_block(struct ResampleContext *c);
+int swri_resample_block(struct ResampleContext *c, AudioData *dst, int dst_size,
+                        const AudioData *src, int src_size);
+int64_t swri_resample_block_out_samples(struct ResampleContext *c, int in_samples);
+
 int swri_rematrix_init(SwrContext *s);
 void swri_rematrix_free(SwrContext *s);
 int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy);
@@ -222,6 +222,94 @@ static void audiogen(void *data, enum AVSampleFormat sample_fmt,
     }
 }
 
+#define BLOCK_SAMPLES 4096
+
+/**
+ * Check the fixed delay block mode: converting in blocks of varying size must
+ * give the same output as a single call, impulses must come out after the
+ * delay reported by swr_get_delay(), and too large out_count must be refused.
+ */
+static int test_block_mode(int in_rate, int out_rate)
+{
+    static const int block_sizes[] = { 1, 7, 64, 100, 333, 512 };
+    static float in[BLOCK_SAMPLES], ref[8 * BLOCK_SAMPLES], out[8 * BLOCK_SAMPLES];
+    struct SwrContext *single = NULL, *split = NULL;
+    const uint8_t *ain[1];
+    uint8_t *aout[1];
+    int64_t delay;
+    int i, ref_count, out_count = 0, in_pos = 0, ret = 1;
+
+    for (i = 0; i < BLOCK_SAMPLES; i++)
+        in[i] = i % 512 == 100 ? 1.0 : 0.0;
+
+    single = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_MONO, AV_SAMPLE_FMT_FLT, out_rate,
+                                      AV_CH_LAYOUT_MONO, AV_SAMPLE_FMT_FLT, in_rate, 0, 0);
+    split  = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_MONO, AV_SAMPLE_FMT_FLT, out_rate,
+                                      AV_CH_LAYOUT_MONO, AV_SAMPLE_FMT_FLT, in_rate, 0, 0);
+    if (!single || !split ||
+        av_opt_set_int(single, "block_size", BLOCK_SAMPLES, 0) < 0 ||
+        av_opt_set_int(split,  "block_size", 512,           0) < 0 ||
+        swr_init(single) < 0 || swr_init(split) < 0) {
+        fprintf(stderr, "block mode init failed\n");
+        goto end;
+    }
+    delay = swr_get_delay(split, in_rate * (int64_t)out_rate);
+
+    ain[0]    = (const uint8_t *)in;
+    aout[0]   = (uint8_t *)ref;
+    ref_count = swr_get_out_samples(single, BLOCK_SAMPLES);
+    if (swr_convert_block(single, aout, ref_count, ain, BLOCK_SAMPLES) != ref_count) {
+        fprintf(stderr, "block mode single call failed\n");
+        goto end;
+    }
+
+    aout[0] = (uint8_t *)out;
+    if (swr_convert_block(split, aout, av_rescale_rnd(512, out_rate, in_rate, AV_ROUND_UP) + 2,
+                          ain, 512) != AVERROR(EINVAL)) {
+        fprintf(stderr, "block mode accepted a too large out_count\n");
+        goto end;
+    }
+    for (i = 0; in_pos < BLOCK_SAMPLES; i++) {
+        int in_count = FFMIN(block_sizes[i % FF_ARRAY_ELEMS(block_sizes)], BLOCK_SAMPLES - in_pos);
+        int count    = swr_get_out_samples(split, in_count);
+        ain[0]  = (const uint8_t *)(in  + in_pos);
+        aout[0] = (uint8_t *)(out + out_count);
+        if (swr_convert_block(split, aout, count, ain, in_count) != count) {
+            fprintf(stderr, "block mode split call failed\n");
+            goto end;
+        }
+        in_pos    += in_count;
+        out_count += count;
+    }
+    if (out_count != ref_count || memcmp(out, ref, ref_count * sizeof(*ref))) {
+        fprintf(stderr, "block mode split output differs\n");
+        goto end;
+    }
+
+    /* The peak of each impulse must be within a sample of where the delay
+     * reported at init puts it. */
+    for (in_pos = 100; in_pos < BLOCK_SAMPLES; in_pos += 512) {
+        int64_t expected = av_rescale(in_pos, out_rate, in_rate) +
+                           av_rescale(delay, 1, in_rate);
+        int peak = expected - 16;
+        for (i = peak; i < expected + 16 && i < out_count; i++)
+            if (fabs(out[i]) > fabs(out[peak]))
+                peak = i;
+        if (FFABS(peak - expected) > 1) {
+            fprintf(stderr, "block mode impulse at %d came out at %d instead of %"PRId64"\n",
+                    in_pos, peak, expected);
+            goto end;
+        }
+    }
+
+    printf("block mode %5d->%5d: ok\n", in_rate, out_rate);
+    ret = 0;
+end:
+    swr_free(&single);
+    swr_free(&split);
+    return ret;
+}
+
 int main(int argc, char **argv){
     int in_sample_rate, out_sample_rate, ch ,i, flush_count;
     uint64_t in_ch_layout, out_ch_layout;
@@ -248,9 +336,14 @@ int main(int argc, char **argv){
     if (argc > 1) {
         if (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
             av_log(NULL, AV_LOG_INFO, "Usage: swresample-test [<num_tests>[ <test>]]  \n"
-                   "num_tests           Default is %d\n", num_tests);
+                   "       swresample-test block\n"
+                   "num_tests           Default is %d\n"
+                   "block               Only test the fixed delay block mode\n", num_tests);
             return 0;
         }
+        if (!strcmp(argv[1], "block"))
+            return test_block_mode(44100, 48000) || test_block_mode(48000, 44100) ||
+                   test_block_mode(48000, 16000) || test_block_mode(8000, 48000);
         num_tests = strtol(argv[1], NULL, 0);
         if(num_tests < 0) {
             num_tests = -num_tests;
@@ -273,6 +366,11 @@ int main(int argc, char **argv){
         FFSWAP(int, remaining_tests[r], remaining_tests[max_tests - test - 1]);
     }
     qsort(remaining_tests + max_tests - num_tests, num_tests, sizeof(remaining_tests[0]), cmp);
+
+    if (test_block_mode(44100, 48000) || test_block_mode(48000, 44100) ||
+        test_block_mode(48000, 16000) || test_block_mode(8000, 48000))
+        return 1;
+
     in_sample_rate=16000;
     for(test=0; test<num_tests; test++){
         char  in_layout_string[256];
@@ -234,9 +234,18 @@ static void lumRangeFromJpeg16_c(int16_t *_dst, int width)
     if (DEBUG_SWSCALE_BUFFERS)                  \
         av_log(c, AV_LOG_DEBUG, __VA_ARGS__)
 
-static int swscale(SwsContext *c, const uint8_t *src[],
-                   int srcStride[], int srcSliceY,
-                   int srcSliceH, uint8_t *dst[], int dstStride[])
+/**
+ * Scale the source slice into the output lines dstSliceY to
+ * dstSliceY + dstSliceH - 1, or as many of them as the slice allows.
+ * When starting a new frame (srcSliceY == 0), output starts at dstSliceY
+ * and the vertical filter ring buffer is filled from the first source line
+ * that output line needs, so any range of output lines can be computed
+ * independently from the others.
+ */
+static int swscale_lines(SwsContext *c, const uint8_t *src[],
+                         int srcStride[], int srcSliceY, int srcSliceH,
+                         uint8_t *dst[], int dstStride[],
+                         int dstSliceY, int dstSliceH)
 {
     /* load a few things into local vars to make the code more readable?
      * and faster */
@@ -343,7 +352,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     if (srcSliceY == 0) {
         lumBufIndex  = -1;
         chrBufIndex  = -1;
-        dstY         = 0;
+        dstY         = dstSliceY;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -375,7 +384,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         hout_slice->width = dstW;
     }
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstSliceY + dstSliceH; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         int use_mmx_vfilter= c->use_mmx_vfilter;
 
@@ -537,6 +546,14 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     return dstY - lastDstY;
 }
 
+static int swscale(SwsContext *c, const uint8_t *src[],
+                   int srcStride[], int srcSliceY,
+                   int srcSliceH, uint8_t *dst[], int dstStride[])
+{
+    return swscale_lines(c, src, srcStride, srcSliceY, srcSliceH,
+                         dst, dstStride, 0, c->dstH);
+}
+
 av_cold void ff_sws_init_range_convert(SwsContext *c)
 {
     c->lumConvertRange = NULL;
@@ -752,6 +769,83 @@ static void rgb48Toxyz12(struct SwsContext *c, uint16_t *dst,
     }
 }
 
+static void update_palette(SwsContext *c, const uint32_t *pal)
+{
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        int r, g, b, y, u, v, a = 0xff;
+        if (c->srcFormat == AV_PIX_FMT_PAL8) {
+            uint32_t p = pal[i];
+            a = (p >> 24) & 0xFF;
+            r = (p >> 16) & 0xFF;
+            g = (p >>  8) & 0xFF;
+            b =  p        & 0xFF;
+        } else if (c->srcFormat == AV_PIX_FMT_RGB8) {
+            r = ( i >> 5     ) * 36;
+            g = ((i >> 2) & 7) * 36;
+            b = ( i       & 3) * 85;
+        } else if (c->srcFormat == AV_PIX_FMT_BGR8) {
+            b = ( i >> 6     ) * 85;
+            g = ((i >> 3) & 7) * 36;
+            r = ( i       & 7) * 36;
+        } else if (c->srcFormat == AV_PIX_FMT_RGB4_BYTE) {
+            r = ( i >> 3     ) * 255;
+            g = ((i >> 1) & 3) * 85;
+            b = ( i       & 1) * 255;
+        } else if (c->srcFormat == AV_PIX_FMT_GRAY8 || c->srcFormat == AV_PIX_FMT_GRAY8A) {
+            r = g = b = i;
+        } else {
+            av_assert1(c->srcFormat == AV_PIX_FMT_BGR4_BYTE);
+            b = ( i >> 3     ) * 255;
+            g = ((i >> 1) & 3) * 85;
+            r = ( i       & 1) * 255;
+        }
+#define RGB2YUV_SHIFT 15
+#define BY ( (int) (0.114 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define BV (-(int) (0.081 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define BU ( (int) (0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define GY ( (int) (0.587 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define GV (-(int) (0.419 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define GU (-(int) (0.331 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define RY ( (int) (0.299 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define RV ( (int) (0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define RU (-(int) (0.169 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+
+        y = av_clip_uint8((RY * r + GY * g + BY * b + ( 33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        u = av_clip_uint8((RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        v = av_clip_uint8((RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        c->pal_yuv[i]= y + (u<<8) + (v<<16) + ((unsigned)a<<24);
+
+        switch (c->dstFormat) {
+        case AV_PIX_FMT_BGR32:
+#if !HAVE_BIGENDIAN
+        case AV_PIX_FMT_RGB24:
+#endif
+            c->pal_rgb[i]=  r + (g<<8) + (b<<16) + ((unsigned)a<<24);
+            break;
+        case AV_PIX_FMT_BGR32_1:
+#if HAVE_BIGENDIAN
+        case AV_PIX_FMT_BGR24:
+#endif
+            c->pal_rgb[i]= a + (r<<8) + (g<<16) + ((unsigned)b<<24);
+            break;
+        case AV_PIX_FMT_RGB32_1:
+#if HAVE_BIGENDIAN
+        case AV_PIX_FMT_RGB24:
+#endif
+            c->pal_rgb[i]= a + (b<<8) + (g<<16) + ((unsigned)r<<24);
+            break;
+        case AV_PIX_FMT_RGB32:
+#if !HAVE_BIGENDIAN
+        case AV_PIX_FMT_BGR24:
+#endif
+        default:
+            c->pal_rgb[i]=  b + (g<<8) + (r<<16) + ((unsigned)a<<24);
+        }
+    }
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
@@ -851,79 +945,8 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         if (srcSliceY == 0) c->sliceDir = 1; else c->sliceDir = -1;
     }
 
-    if (usePal(c->srcFormat)) {
-        for (i = 0; i < 256; i++) {
-            int r, g, b, y, u, v, a = 0xff;
-            if (c->srcFormat == AV_PIX_FMT_PAL8) {
-                uint32_t p = ((const uint32_t *)(srcSlice[1]))[i];
-                a = (p >> 24) & 0xFF;
-                r = (p >> 16) & 0xFF;
-                g = (p >>  8) & 0xFF;
-                b =  p        & 0xFF;
-            } else if (c->srcFormat == AV_PIX_FMT_RGB8) {
-                r = ( i >> 5     ) * 36;
-                g = ((i >> 2) & 7) * 36;
-                b = ( i       & 3) * 85;
-            } else if (c->srcFormat == AV_PIX_FMT_BGR8) {
-                b = ( i >> 6     ) * 85;
-                g = ((i >> 3) & 7) * 36;
-                r = ( i       & 7) * 36;
-            } else if (c->srcFormat == AV_PIX_FMT_RGB4_BYTE) {
-                r = ( i >> 3     ) * 255;
-                g = ((i >> 1) & 3) * 85;
-                b = ( i       & 1) * 255;
-            } else if (c->srcFormat == AV_PIX_FMT_GRAY8 || c->srcFormat == AV_PIX_FMT_GRAY8A) {
-                r = g = b = i;
-            } else {
-                av_assert1(c->srcFormat == AV_PIX_FMT_BGR4_BYTE);
-                b = ( i >> 3     ) * 255;
-                g = ((i >> 1) & 3) * 85;
-                r = ( i       & 1) * 255;
-            }
-#define RGB2YUV_SHIFT 15
-#define BY ( (int) (0.114 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define BV (-(int) (0.081 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define BU ( (int) (0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GY ( (int) (0.587 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GV (-(int) (0.419 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GU (-(int) (0.331 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RY ( (int) (0.299 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RV ( (int) (0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RU (-(int) (0.169 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-
-            y = av_clip_uint8((RY * r + GY * g + BY * b + ( 33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            u = av_clip_uint8((RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            v = av_clip_uint8((RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            c->pal_yuv[i]= y + (u<<8) + (v<<16) + ((unsigned)a<<24);
-
-            switch (c->dstFormat) {
-            case AV_PIX_FMT_BGR32:
-#if !HAVE_BIGENDIAN
-            case AV_PIX_FMT_RGB24:
-#endif
-                c->pal_rgb[i]=  r + (g<<8) + (b<<16) + ((unsigned)a<<24);
-                break;
-            case AV_PIX_FMT_BGR32_1:
-#if HAVE_BIGENDIAN
-            case AV_PIX_FMT_BGR24:
-#endif
-                c->pal_rgb[i]= a + (r<<8) + (g<<16) + ((unsigned)b<<24);
-                break;
-            case AV_PIX_FMT_RGB32_1:
-#if HAVE_BIGENDIAN
-            case AV_PIX_FMT_RGB24:
-#endif
-                c->pal_rgb[i]= a + (b<<8) + (g<<16) + ((unsigned)r<<24);
-                break;
-            case AV_PIX_FMT_RGB32:
-#if !HAVE_BIGENDIAN
-            case AV_PIX_FMT_BGR24:
-#endif
-            default:
-                c->pal_rgb[i]=  b + (g<<8) + (r<<16) + ((unsigned)a<<24);
-            }
-        }
-    }
+    if (usePal(c->srcFormat))
+        update_palette(c, (const uint32_t *)srcSlice[1]);
 
     if (c->src0Alpha && !c->dst0Alpha && isALPHA(c->dstFormat)) {
         uint8_t *base;
@@ -1000,3 +1023,109 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     av_free(rgb0_tmp);
     return ret;
 }
+
+/**
+ * Check whether the output frame can be split between the slice contexts.
+ * Error diffusion dithering carries state from one line to the next, and
+ * the conversions needing temporary buffers or cascaded contexts are only
+ * handled by sws_scale().
+ */
+static int can_split_frame(SwsContext *c)
+{
+    return c->nb_slice_ctx > 1 &&
+           c->swscale == swscale &&
+           !c->cascaded_context[0] &&
+           c->dither != SWS_DITHER_ED &&
+           !c->srcXYZ && !c->dstXYZ &&
+           !(c->src0Alpha && !c->dst0Alpha && isALPHA(c->dstFormat)) &&
+           c->dstH >= 2 * c->nb_slice_ctx;
+}
+
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwsContext *parent = priv;
+    SwsContext      *c = parent->slice_ctx[threadnr];
+    const AVFrame *src = parent->frame_src;
+    AVFrame       *dst = parent->frame_dst;
+    const int    align = 1 << c->chrDstVSubSample;
+    const int  slice_h = FFALIGN((c->dstH + nb_jobs - 1) / nb_jobs, align);
+    const int  slice_y = jobnr * slice_h;
+    const uint8_t *src2[4];
+    uint8_t *dst2[4];
+    int srcStride2[4], dstStride2[4];
+    int i, ret;
+
+    parent->slice_err[jobnr] = 0;
+    if (slice_y >= c->dstH)
+        return;
+
+    for (i = 0; i < 4; i++) {
+        src2[i]       = src->data[i];
+        dst2[i]       = dst->data[i];
+        srcStride2[i] = src->linesize[i];
+        dstStride2[i] = dst->linesize[i];
+    }
+    reset_ptr(src2, c->srcFormat);
+    reset_ptr((void*)dst2, c->dstFormat);
+
+    ret = swscale_lines(c, src2, srcStride2, 0, c->srcH, dst2, dstStride2,
+                        slice_y, FFMIN(slice_h, c->dstH - slice_y));
+    if (ret < 0)
+        parent->slice_err[jobnr] = ret;
+}
+
+int attribute_align_arg sws_scale_frame(struct SwsContext *c, AVFrame *dst,
+                                        const AVFrame *src)
+{
+    int i, ret;
+
+    if (src->width != c->srcW || src->height != c->srcH) {
+        av_log(c, AV_LOG_ERROR, "Source frame size %dx%d does not match the context %dx%d\n",
+               src->width, src->height, c->srcW, c->srcH);
+        return AVERROR(EINVAL);
+    }
+
+    if (!dst->buf[0]) {
+        dst->width  = c->dstW;
+        dst->height = c->dstH;
+        dst->format = c->dstFormat;
+        ret = av_frame_get_buffer(dst, 0);
+        if (ret < 0)
+            return ret;
+    } else if (dst->width != c->dstW || dst->height != c->dstH) {
+        av_log(c, AV_LOG_ERROR, "Destination frame size %dx%d does not match the context %dx%d\n",
+               dst->width, dst->height, c->dstW, c->dstH);
+        return AVERROR(EINVAL);
+    }
+
+    if (!can_split_frame(c)) {
+        ret = sws_scale(c, (const uint8_t * const *)src->data, src->linesize,
+                        0, src->height, dst->data, dst->linesize);
+        return ret < 0 ? ret : 0;
+    }
+
+    if (!check_image_pointers((const uint8_t * const *)src->data, c->srcFormat, src->linesize) ||
+        !check_image_pointers((const uint8_t * const *)dst->data, c->dstFormat, dst->linesize)) {
+        av_log(c, AV_LOG_ERROR, "bad frame pointers\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (i = 0; i < c->nb_slice_ctx; i++) {
+        if (usePal(c->srcFormat))
+            update_palette(c->slice_ctx[i], (const uint32_t *)src->data[1]);
+    }
+
+    c->frame_src = src;
+    c->frame_dst = dst;
+    avpriv_slicethread_execute(c->slicethread, c->nb_slice_ctx, 0);
+    c->frame_src = NULL;
+    c->frame_dst = NULL;
+
+    for (i = 0; i < c->nb_slice_ctx; i++) {
+        if (c->slice_err[i] < 0)
+            return c->slice_err[i];
+    }
+
+    return 0;
+}
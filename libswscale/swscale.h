@@ -30,6 +30,7 @@
 #include <stdint.h>
 
 #include "libavutil/avutil.h"
+#include "libavutil/frame.h"
 #include "libavutil/log.h"
 #include "libavutil/pixfmt.h"
 #include "version.h"
@@ -218,6 +219,24 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               const int srcStride[], int srcSliceY, int srcSliceH,
               uint8_t *const dst[], const int dstStride[]);
 
+/**
+ * Scale a whole frame.
+ *
+ * The output is split in slices of lines which are computed in parallel by
+ * the number of threads set with the "threads" option of the context. The
+ * result is the same as the one of sws_scale() called on the whole frame,
+ * whatever the number of threads.
+ *
+ * @param c   the scaling context previously created with sws_getContext()
+ *            or sws_init_context()
+ * @param dst the destination frame; if it has no buffers, they are
+ *            allocated with av_frame_get_buffer() after setting its size
+ *            and format from the context
+ * @param src the source frame, its size must be the one of the context
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src);
+
 /**
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
  * @param srcRange flag indicating the while-black range of the input (1=jpeg / 0=mpeg)
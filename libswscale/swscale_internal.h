@@ -27,10 +27,12 @@
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
 #include "libavutil/common.h"
+#include "libavutil/frame.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/log.h"
 #include "libavutil/pixfmt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/ppc/util_altivec.h"
 
 #define STR(s) AV_TOSTRING(s) // AV_STRINGIFY is too long
@@ -321,6 +323,18 @@ typedef struct SwsContext {
     uint8_t *cascaded1_tmp[4];
     int cascaded_mainindex;
 
+    /* The slice_* fields are used by sws_scale_frame() to split the output
+     * frame between nb_slice_ctx threads, each one running its own copy of
+     * this context on a range of output lines.
+     */
+    int nb_threads;               ///< Number of threads requested by the user, 0 for automatic.
+    AVSliceThread *slicethread;
+    struct SwsContext **slice_ctx;
+    int *slice_err;
+    int nb_slice_ctx;
+    const AVFrame *frame_src;
+    AVFrame *frame_dst;
+
     double gamma_value;
     int gamma_flag;
     int is_internal_gamma;
@@ -625,6 +639,8 @@ typedef struct SwsContext {
     SwsDither dither;
 
     SwsAlphaBlend alphablend;
+
+    int filter_cache_hits; ///< number of filters copied from the filter cache
 } SwsContext;
 //FIXME check init (where 0)
 
@@ -973,6 +989,10 @@ int ff_init_slice_from_src(SwsSlice * s, uint8_t *src[4], int stride[4], int src
 // Initialize scaler filter descriptor chain
 int ff_init_filters(SwsContext *c);
 
+// Slice threading worker of sws_scale_frame(), c->slicethread callback
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads);
+
 // Free all filter data
 int ff_free_filters(SwsContext *c);
 
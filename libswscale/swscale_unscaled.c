@@ -282,6 +282,169 @@ static int planar8ToP01xleWrapper(SwsContext *c, const uint8_t *src[],
 
 #undef output_pixel
 
+static int p01xToPlanarWrapper(SwsContext *c, const uint8_t *src8[],
+                               int srcStride[], int srcSliceY,
+                               int srcSliceH, uint8_t *dstParam8[],
+                               int dstStride[])
+{
+    const AVPixFmtDescriptor *src_format = av_pix_fmt_desc_get(c->srcFormat);
+    const uint16_t *srcY  = (const uint16_t*)src8[0];
+    const uint16_t *srcUV = (const uint16_t*)src8[1];
+    uint16_t *dstY = (uint16_t*)(dstParam8[0] + dstStride[0] * srcSliceY);
+    uint16_t *dstU = (uint16_t*)(dstParam8[1] + dstStride[1] * srcSliceY / 2);
+    uint16_t *dstV = (uint16_t*)(dstParam8[2] + dstStride[2] * srcSliceY / 2);
+    const int shift = src_format->comp[0].shift;
+    int x, y;
+
+    av_assert0(!(srcStride[0] % 2 || srcStride[1] % 2 ||
+                 dstStride[0] % 2 || dstStride[1] % 2 || dstStride[2] % 2));
+
+    for (y = 0; y < srcSliceH; y++) {
+        for (x = 0; x < c->srcW; x++)
+            dstY[x] = srcY[x] >> shift;
+        srcY += srcStride[0] / 2;
+        dstY += dstStride[0] / 2;
+
+        if (!(y & 1)) {
+            for (x = 0; x < c->chrSrcW; x++) {
+                dstU[x] = srcUV[2 * x    ] >> shift;
+                dstV[x] = srcUV[2 * x + 1] >> shift;
+            }
+            srcUV += srcStride[1] / 2;
+            dstU  += dstStride[1] / 2;
+            dstV  += dstStride[2] / 2;
+        }
+    }
+
+    return srcSliceH;
+}
+
+/* Same rounding and ordered dither as the 16->15 bit horizontal scaler
+ * followed by yuv2plane1_8_c()/yuv2nv12cX_c() with an identity filter,
+ * so the output matches the generic path bit for bit. */
+static av_always_inline void dither_line_16to8(uint8_t *dst, int dst_step,
+                                               const uint16_t *src, int src_step,
+                                               int width, int shift, int depth,
+                                               const uint8_t *dither, int offset)
+{
+    int x;
+
+    for (x = 0; x < width; x++) {
+        int val = (src[x * src_step] >> shift) * (1 << 14) >> (depth - 1);
+        dst[x * dst_step] = av_clip_uint8((val + dither[(x + offset) & 7]) >> 7);
+    }
+}
+
+static int yuv420p1xToNv12Wrapper(SwsContext *c, const uint8_t *src8[],
+                                  int srcStride[], int srcSliceY,
+                                  int srcSliceH, uint8_t *dstParam[],
+                                  int dstStride[])
+{
+    const AVPixFmtDescriptor *src_format = av_pix_fmt_desc_get(c->srcFormat);
+    const int depth = src_format->comp[0].depth;
+    const int shift = src_format->comp[0].shift;
+    const int src_step = src_format->comp[1].step / 2;
+    const int planeU = src_format->comp[1].plane;
+    const int planeV = src_format->comp[2].plane;
+    const uint16_t *srcY = (const uint16_t*)src8[0];
+    const uint16_t *srcU = (const uint16_t*)src8[planeU] + src_format->comp[1].offset / 2;
+    const uint16_t *srcV = (const uint16_t*)src8[planeV] + src_format->comp[2].offset / 2;
+    uint8_t *dstY = dstParam[0] + dstStride[0] * srcSliceY;
+    uint8_t *dstU, *dstV;
+    int dst_step, dstStrideU, dstStrideV;
+    int y;
+
+    if (c->dstFormat == AV_PIX_FMT_YUV420P) {
+        dstU = dstParam[1] + dstStride[1] * srcSliceY / 2;
+        dstV = dstParam[2] + dstStride[2] * srcSliceY / 2;
+        dstStrideU = dstStride[1];
+        dstStrideV = dstStride[2];
+        dst_step = 1;
+    } else {
+        dstU = dstParam[1] + dstStride[1] * srcSliceY / 2;
+        dstV = dstU + 1;
+        if (c->dstFormat == AV_PIX_FMT_NV21)
+            FFSWAP(uint8_t*, dstU, dstV);
+        dstStrideU = dstStrideV = dstStride[1];
+        dst_step = 2;
+    }
+
+    av_assert0(!(srcStride[0] % 2 || srcStride[planeU] % 2 || srcStride[planeV] % 2));
+
+    for (y = 0; y < srcSliceH; y++) {
+        const uint8_t *dither = ff_dither_8x8_128[(srcSliceY + y) & 7];
+
+        dither_line_16to8(dstY, 1, srcY, 1, c->srcW, shift, depth, dither, 0);
+        srcY += srcStride[0] / 2;
+        dstY += dstStride[0];
+
+        if (!(y & 1)) {
+            dither = ff_dither_8x8_128[((srcSliceY + y) >> 1) & 7];
+            dither_line_16to8(dstU, dst_step, srcU, src_step, c->chrSrcW,
+                              shift, depth, dither, 0);
+            dither_line_16to8(dstV, dst_step, srcV, src_step, c->chrSrcW,
+                              shift, depth, dither, 3);
+            srcU += srcStride[planeU] / 2;
+            srcV += srcStride[planeV] / 2;
+            dstU += dstStrideU;
+            dstV += dstStrideV;
+        }
+    }
+
+    return srcSliceH;
+}
+
+static int nv12ToPlanar1xWrapper(SwsContext *c, const uint8_t *src[],
+                                 int srcStride[], int srcSliceY,
+                                 int srcSliceH, uint8_t *dstParam8[],
+                                 int dstStride[])
+{
+    const AVPixFmtDescriptor *dst_format = av_pix_fmt_desc_get(c->dstFormat);
+    const int shift = dst_format->comp[0].depth + dst_format->comp[0].shift - 8;
+    const uint8_t *srcY  = src[0];
+    const uint8_t *srcUV = src[1];
+    uint16_t *dstY = (uint16_t*)(dstParam8[0] + dstStride[0] * srcSliceY);
+    uint16_t *dstU, *dstV;
+    int dst_step, dstStrideU, dstStrideV;
+    int x, y;
+
+    av_assert0(!(dstStride[0] % 2 || dstStride[1] % 2 || dstStride[2] % 2));
+
+    if (isSemiPlanarYUV(c->dstFormat)) {
+        dstU = (uint16_t*)(dstParam8[1] + dstStride[1] * srcSliceY / 2);
+        dstV = dstU + 1;
+        dstStrideU = dstStrideV = dstStride[1] / 2;
+        dst_step = 2;
+    } else {
+        dstU = (uint16_t*)(dstParam8[1] + dstStride[1] * srcSliceY / 2);
+        dstV = (uint16_t*)(dstParam8[2] + dstStride[2] * srcSliceY / 2);
+        dstStrideU = dstStride[1] / 2;
+        dstStrideV = dstStride[2] / 2;
+        dst_step = 1;
+    }
+    if (c->srcFormat == AV_PIX_FMT_NV21)
+        FFSWAP(uint16_t*, dstU, dstV);
+
+    for (y = 0; y < srcSliceH; y++) {
+        for (x = 0; x < c->srcW; x++)
+            dstY[x] = srcY[x] << shift;
+        srcY += srcStride[0];
+        dstY += dstStride[0] / 2;
+
+        if (!(y & 1)) {
+            for (x = 0; x < c->chrSrcW; x++) {
+                dstU[x * dst_step] = srcUV[2 * x    ] << shift;
+                dstV[x * dst_step] = srcUV[2 * x + 1] << shift;
+            }
+            srcUV += srcStride[1];
+            dstU  += dstStrideU;
+            dstV  += dstStrideV;
+        }
+    }
+
+    return srcSliceH;
+}
+
 static int planarToYuy2Wrapper(SwsContext *c, const uint8_t *src[],
                                int srcStride[], int srcSliceY, int srcSliceH,
                                uint8_t *dstParam[], int dstStride[])
@@ -1891,6 +2054,32 @@ void ff_get_unscaled_swscale(SwsContext *c)
         (dstFormat == AV_PIX_FMT_P010 || dstFormat == AV_PIX_FMT_P016)) {
         c->swscale = planarToP01xWrapper;
     }
+    /* p01x_to_yuv420p1x */
+    if ((srcFormat == AV_PIX_FMT_P010 && dstFormat == AV_PIX_FMT_YUV420P10) ||
+        (srcFormat == AV_PIX_FMT_P016 && dstFormat == AV_PIX_FMT_YUV420P16)) {
+        c->swscale = p01xToPlanarWrapper;
+    }
+    /* yuv420p1x_to_nv12, p01x_to_nv12 */
+    if ((srcFormat == AV_PIX_FMT_YUV420P9  || srcFormat == AV_PIX_FMT_YUV420P10 ||
+         srcFormat == AV_PIX_FMT_YUV420P12 || srcFormat == AV_PIX_FMT_YUV420P14 ||
+         srcFormat == AV_PIX_FMT_YUV420P16 ||
+         srcFormat == AV_PIX_FMT_P010      || srcFormat == AV_PIX_FMT_P016) &&
+        (dstFormat == AV_PIX_FMT_NV12 || dstFormat == AV_PIX_FMT_NV21)) {
+        c->swscale = yuv420p1xToNv12Wrapper;
+    }
+    /* p01x_to_yuv420p */
+    if ((srcFormat == AV_PIX_FMT_P010 || srcFormat == AV_PIX_FMT_P016) &&
+        dstFormat == AV_PIX_FMT_YUV420P) {
+        c->swscale = yuv420p1xToNv12Wrapper;
+    }
+    /* nv12_to_yuv420p1x, nv12_to_p01x */
+    if ((srcFormat == AV_PIX_FMT_NV12 || srcFormat == AV_PIX_FMT_NV21) &&
+        (dstFormat == AV_PIX_FMT_YUV420P9  || dstFormat == AV_PIX_FMT_YUV420P10 ||
+         dstFormat == AV_PIX_FMT_YUV420P12 || dstFormat == AV_PIX_FMT_YUV420P14 ||
+         dstFormat == AV_PIX_FMT_YUV420P16 ||
+         dstFormat == AV_PIX_FMT_P010      || dstFormat == AV_PIX_FMT_P016)) {
+        c->swscale = nv12ToPlanar1xWrapper;
+    }
     /* yuv420p_to_p01xle */
     if ((srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUVA420P) &&
         (dstFormat == AV_PIX_FMT_P010LE || dstFormat == AV_PIX_FMT_P016LE)) {
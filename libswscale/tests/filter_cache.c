@@ -0,0 +1,167 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Check that a context created after an identical one has been freed gets
+ * its filters from the filter cache, and that they are the same filters the
+ * first context computed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+static const struct {
+    enum AVPixelFormat src_format, dst_format;
+    int src_w, src_h, dst_w, dst_h;
+    int flags;
+} tests[] = {
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_YUV420P,     1920, 1080, 320, 180, SWS_LANCZOS  },
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_YUV420P,      352,  288, 640, 360, SWS_BICUBIC  },
+    { AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_YUV420P,      352,  288, 352, 288, SWS_BILINEAR },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_YUV444P,      320,  240, 123,  77, SWS_SPLINE   },
+    { AV_PIX_FMT_GRAY8,       AV_PIX_FMT_GRAY16LE,     100,  100,  33, 250, SWS_GAUSS    },
+};
+
+static const char *const filter_names[4] = { "hLum", "hChr", "vLum", "vChr" };
+
+/* copy of the filters of a context */
+typedef struct Filters {
+    int16_t *filter[4];
+    int32_t *pos[4];
+    int size[4];
+    int dst[4];
+} Filters;
+
+static struct SwsContext *get_context(int i)
+{
+    return sws_getContext(tests[i].src_w, tests[i].src_h, tests[i].src_format,
+                          tests[i].dst_w, tests[i].dst_h, tests[i].dst_format,
+                          tests[i].flags, NULL, NULL, NULL);
+}
+
+static void get_filters(const SwsContext *c, int n,
+                        const int16_t **filter, const int32_t **pos,
+                        int *size, int *dst)
+{
+    switch (n) {
+    case 0: *filter = c->hLumFilter; *pos = c->hLumFilterPos; *size = c->hLumFilterSize; *dst = c->dstW;    break;
+    case 1: *filter = c->hChrFilter; *pos = c->hChrFilterPos; *size = c->hChrFilterSize; *dst = c->chrDstW; break;
+    case 2: *filter = c->vLumFilter; *pos = c->vLumFilterPos; *size = c->vLumFilterSize; *dst = c->dstH;    break;
+    case 3: *filter = c->vChrFilter; *pos = c->vChrFilterPos; *size = c->vChrFilterSize; *dst = c->chrDstH; break;
+    }
+}
+
+static void free_filters(Filters *f)
+{
+    int n;
+
+    for (n = 0; n < 4; n++) {
+        av_freep(&f->filter[n]);
+        av_freep(&f->pos[n]);
+    }
+}
+
+static int copy_filters(Filters *f, const SwsContext *c)
+{
+    int n;
+
+    for (n = 0; n < 4; n++) {
+        const int16_t *filter;
+        const int32_t *pos;
+
+        get_filters(c, n, &filter, &pos, &f->size[n], &f->dst[n]);
+        if (!filter)
+            continue;
+        f->filter[n] = av_memdup(filter, f->dst[n] * f->size[n] * sizeof(*filter));
+        f->pos[n]    = av_memdup(pos,    f->dst[n] * sizeof(*pos));
+        if (!f->filter[n] || !f->pos[n]) {
+            free_filters(f);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int compare_filters(const Filters *f, const SwsContext *c)
+{
+    int n, ret = 0;
+
+    for (n = 0; n < 4; n++) {
+        const int16_t *filter;
+        const int32_t *pos;
+        int size, dst;
+
+        get_filters(c, n, &filter, &pos, &size, &dst);
+        if (!f->filter[n] != !filter || size != f->size[n] || dst != f->dst[n] ||
+            (filter && (memcmp(pos, f->pos[n], dst * sizeof(*pos)) ||
+                        memcmp(filter, f->filter[n], dst * size * sizeof(*filter))))) {
+            printf(" %s differs", filter_names[n]);
+            ret = 1;
+        }
+    }
+    return ret;
+}
+
+int main(void)
+{
+    int i, ret = 0;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        struct SwsContext *computed, *cached;
+        Filters filters = { { 0 } };
+
+        printf("%s %dx%d -> %s %dx%d flags 0x%x:",
+               av_get_pix_fmt_name(tests[i].src_format), tests[i].src_w, tests[i].src_h,
+               av_get_pix_fmt_name(tests[i].dst_format), tests[i].dst_w, tests[i].dst_h,
+               tests[i].flags);
+
+        /* The first context computes its filters and is freed before the
+         * second one is created, which has to find them in the cache. */
+        computed = get_context(i);
+        if (!computed || copy_filters(&filters, computed) < 0) {
+            printf(" init failed\n");
+            sws_freeContext(computed);
+            ret = 1;
+            continue;
+        }
+        sws_freeContext(computed);
+
+        cached = get_context(i);
+        if (!cached) {
+            printf(" init failed");
+            ret = 1;
+        } else if (!cached->filter_cache_hits) {
+            printf(" no cache hit");
+            ret = 1;
+        } else if (compare_filters(&filters, cached)) {
+            ret = 1;
+        } else {
+            printf(" %d filters cached, ok", cached->filter_cache_hits);
+        }
+        printf("\n");
+        sws_freeContext(cached);
+        free_filters(&filters);
+    }
+
+    return ret;
+}
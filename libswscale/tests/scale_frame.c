@@ -0,0 +1,176 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Check that sws_scale_frame() gives the same output whatever the number of
+ * threads of the context.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/lfg.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+static const struct {
+    enum AVPixelFormat src_format, dst_format;
+    int src_w, src_h, dst_w, dst_h;
+    int flags;
+} tests[] = {
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_YUV420P,     352, 288, 176, 144, SWS_BILINEAR },
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_YUV420P,     352, 288, 640, 360, SWS_BICUBIC  },
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_RGB24,       352, 288, 123,  77, SWS_LANCZOS  },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_YUV420P,     320, 240, 320, 240, SWS_BICUBIC  },
+    { AV_PIX_FMT_BGRA,        AV_PIX_FMT_YUVA420P,    320, 240, 200, 150, SWS_AREA     },
+    { AV_PIX_FMT_NV12,        AV_PIX_FMT_YUV444P,     352, 288, 352, 288, SWS_POINT    },
+    { AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_YUV420P,     352, 288, 352, 288, SWS_BILINEAR },
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_YUV420P10LE, 352, 288, 720, 576, SWS_SPLINE   },
+    { AV_PIX_FMT_GRAY8,       AV_PIX_FMT_GRAY16LE,    100, 100,  33, 250, SWS_GAUSS    },
+};
+
+static const int thread_counts[] = { 2, 3, 7 };
+
+static void fill_frame(AVFrame *frame, AVLFG *lfg)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    const int depth = desc->comp[0].depth;
+    int p, x, y;
+
+    for (p = 0; p < 4 && frame->data[p]; p++) {
+        const int h = p == 1 || p == 2 ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h)
+                                       : frame->height;
+        for (y = 0; y < h; y++) {
+            uint8_t *line = frame->data[p] + y * frame->linesize[p];
+            if (depth > 8) {
+                for (x = 0; x < frame->linesize[p] / 2; x++)
+                    ((uint16_t *)line)[x] = av_lfg_get(lfg) & ((1 << depth) - 1);
+            } else {
+                for (x = 0; x < frame->linesize[p]; x++)
+                    line[x] = av_lfg_get(lfg);
+            }
+        }
+    }
+}
+
+static int compare_frames(const AVFrame *a, const AVFrame *b)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(a->format);
+    int p, y;
+
+    for (p = 0; p < 4 && a->data[p]; p++) {
+        const int h = p == 1 || p == 2 ? AV_CEIL_RSHIFT(a->height, desc->log2_chroma_h)
+                                       : a->height;
+        const int size = av_image_get_linesize(a->format, a->width, p);
+
+        for (y = 0; y < h; y++)
+            if (memcmp(a->data[p] + y * a->linesize[p],
+                       b->data[p] + y * b->linesize[p], size))
+                return 1;
+    }
+    return 0;
+}
+
+static struct SwsContext *alloc_context(int i, int threads)
+{
+    struct SwsContext *c = sws_alloc_context();
+
+    if (!c)
+        return NULL;
+    av_opt_set_int(c, "srcw",       tests[i].src_w,      0);
+    av_opt_set_int(c, "srch",       tests[i].src_h,      0);
+    av_opt_set_int(c, "src_format", tests[i].src_format, 0);
+    av_opt_set_int(c, "dstw",       tests[i].dst_w,      0);
+    av_opt_set_int(c, "dsth",       tests[i].dst_h,      0);
+    av_opt_set_int(c, "dst_format", tests[i].dst_format, 0);
+    av_opt_set_int(c, "sws_flags",  tests[i].flags,      0);
+    av_opt_set_int(c, "threads",    threads,             0);
+    if (sws_init_context(c, NULL, NULL) < 0) {
+        sws_freeContext(c);
+        return NULL;
+    }
+    return c;
+}
+
+static int scale(int i, int threads, const AVFrame *src, AVFrame *dst)
+{
+    struct SwsContext *c = alloc_context(i, threads);
+    int ret;
+
+    if (!c)
+        return -1;
+    ret = sws_scale_frame(c, dst, src);
+    sws_freeContext(c);
+    return ret;
+}
+
+int main(void)
+{
+    AVFrame *src = av_frame_alloc(), *ref = av_frame_alloc(), *dst = av_frame_alloc();
+    AVLFG lfg;
+    int i, j, ret = 0;
+
+    if (!src || !ref || !dst)
+        return 1;
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        printf("%s %dx%d -> %s %dx%d flags 0x%x:",
+               av_get_pix_fmt_name(tests[i].src_format), tests[i].src_w, tests[i].src_h,
+               av_get_pix_fmt_name(tests[i].dst_format), tests[i].dst_w, tests[i].dst_h,
+               tests[i].flags);
+
+        src->format = tests[i].src_format;
+        src->width  = tests[i].src_w;
+        src->height = tests[i].src_h;
+        if (av_frame_get_buffer(src, 0) < 0)
+            return 1;
+        fill_frame(src, &lfg);
+
+        if (scale(i, 1, src, ref) < 0) {
+            printf(" scaling failed\n");
+            ret = 1;
+        } else {
+            for (j = 0; j < FF_ARRAY_ELEMS(thread_counts); j++) {
+                if (scale(i, thread_counts[j], src, dst) < 0) {
+                    printf(" %d threads failed", thread_counts[j]);
+                    ret = 1;
+                } else if (compare_frames(ref, dst)) {
+                    printf(" %d threads differ", thread_counts[j]);
+                    ret = 1;
+                } else {
+                    printf(" %d threads ok", thread_counts[j]);
+                }
+                av_frame_unref(dst);
+            }
+            printf("\n");
+        }
+
+        av_frame_unref(src);
+        av_frame_unref(ref);
+    }
+
+    av_frame_free(&src);
+    av_frame_free(&ref);
+    av_frame_free(&dst);
+
+    return ret;
+}
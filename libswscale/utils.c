@@ -41,6 +41,7 @@
 #include "libavutil/attributes.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
+#include "libavutil/buffer.h"
 #include "libavutil/bswap.h"
 #include "libavutil/cpu.h"
 #include "libavutil/imgutils.h"
@@ -49,6 +50,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/aarch64/cpu.h"
 #include "libavutil/ppc/cpu.h"
 #include "libavutil/x86/asm.h"
@@ -326,12 +328,12 @@ static const ScaleAlgorithm scale_algorithms[] = {
     { SWS_X,             "experimental",                    8 },
 };
 
-static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
-                              int *outFilterSize, int xInc, int srcW,
-                              int dstW, int filterAlign, int one,
-                              int flags, int cpu_flags,
-                              SwsVector *srcFilter, SwsVector *dstFilter,
-                              double param[2], int srcPos, int dstPos)
+static av_cold int compute_filter(int16_t **outFilter, int32_t **filterPos,
+                                  int *outFilterSize, int xInc, int srcW,
+                                  int dstW, int filterAlign, int one,
+                                  int flags, int cpu_flags,
+                                  SwsVector *srcFilter, SwsVector *dstFilter,
+                                  double param[2], int srcPos, int dstPos)
 {
     int i;
     int filterSize;
@@ -723,6 +725,166 @@ fail:
     return ret;
 }
 
+/*
+ * Process-wide cache of computed filters. Applications creating many
+ * short-lived contexts with a few geometries would otherwise recompute
+ * the same coefficients over and over. The entries are never modified once
+ * added; each context gets its own copy, as the coefficients are rearranged
+ * in place for some of the SIMD scalers afterwards. The cache is bounded to
+ * FILTER_CACHE_SIZE entries, the least recently used one is replaced.
+ */
+#define FILTER_CACHE_SIZE 32
+
+typedef struct FilterCacheKey {
+    int xInc, srcW, dstW;
+    int filterAlign, one;
+    int flags, cpu_flags;
+    double param[2];
+    int srcPos, dstPos;
+} FilterCacheKey;
+
+typedef struct FilterCacheEntry {
+    FilterCacheKey key;
+    AVBufferRef *buf;   ///< filterPos, followed by the coefficients
+    int filterSize;
+    uint64_t last_used;
+} FilterCacheEntry;
+
+static AVMutex filter_cache_mutex = AV_MUTEX_INITIALIZER;
+static FilterCacheEntry filter_cache[FILTER_CACHE_SIZE];
+static uint64_t filter_cache_clock;
+
+static int filter_cache_key_equal(const FilterCacheKey *a, const FilterCacheKey *b)
+{
+    return a->xInc        == b->xInc        && a->srcW      == b->srcW      &&
+           a->dstW        == b->dstW        && a->filterAlign == b->filterAlign &&
+           a->one         == b->one         && a->flags     == b->flags     &&
+           a->cpu_flags   == b->cpu_flags   &&
+           a->param[0]    == b->param[0]    && a->param[1]  == b->param[1]  &&
+           a->srcPos      == b->srcPos      && a->dstPos    == b->dstPos;
+}
+
+static AVBufferRef *filter_cache_get(const FilterCacheKey *key, int *filterSize)
+{
+    AVBufferRef *buf = NULL;
+    int i;
+
+    ff_mutex_lock(&filter_cache_mutex);
+    for (i = 0; i < FILTER_CACHE_SIZE; i++) {
+        FilterCacheEntry *e = &filter_cache[i];
+        if (e->buf && filter_cache_key_equal(&e->key, key)) {
+            buf = av_buffer_ref(e->buf);
+            if (buf) {
+                *filterSize  = e->filterSize;
+                e->last_used = ++filter_cache_clock;
+            }
+            break;
+        }
+    }
+    ff_mutex_unlock(&filter_cache_mutex);
+
+    return buf;
+}
+
+static void filter_cache_add(const FilterCacheKey *key, AVBufferRef *buf,
+                             int filterSize)
+{
+    FilterCacheEntry *e = &filter_cache[0];
+    int i;
+
+    ff_mutex_lock(&filter_cache_mutex);
+    for (i = 0; i < FILTER_CACHE_SIZE; i++) {
+        FilterCacheEntry *cur = &filter_cache[i];
+        if (cur->buf && filter_cache_key_equal(&cur->key, key)) {
+            // another thread got there first
+            av_buffer_unref(&buf);
+            break;
+        }
+        if (!cur->buf || cur->last_used < e->last_used)
+            e = cur;
+        if (!cur->buf)
+            break;
+    }
+    if (buf) {
+        av_buffer_unref(&e->buf);
+        e->key        = *key;
+        e->buf        = buf;
+        e->filterSize = filterSize;
+        e->last_used  = ++filter_cache_clock;
+    }
+    ff_mutex_unlock(&filter_cache_mutex);
+}
+
+static av_cold int initFilter(SwsContext *c,
+                              int16_t **outFilter, int32_t **filterPos,
+                              int *outFilterSize, int xInc, int srcW,
+                              int dstW, int filterAlign, int one,
+                              int flags, int cpu_flags,
+                              SwsVector *srcFilter, SwsVector *dstFilter,
+                              double param[2], int srcPos, int dstPos)
+{
+    const size_t pos_size = (dstW + 3) * sizeof(**filterPos);
+    FilterCacheKey key = { 0 };
+    AVBufferRef *buf;
+    size_t filter_size;
+    int ret;
+
+    // user supplied vectors and debug output bypass the cache
+    if (srcFilter || dstFilter || (flags & SWS_PRINT_INFO))
+        return compute_filter(outFilter, filterPos, outFilterSize, xInc,
+                              srcW, dstW, filterAlign, one, flags, cpu_flags,
+                              srcFilter, dstFilter, param, srcPos, dstPos);
+
+    key.xInc        = xInc;
+    key.srcW        = srcW;
+    key.dstW        = dstW;
+    key.filterAlign = filterAlign;
+    key.one         = one;
+    key.flags       = flags;
+    key.cpu_flags   = cpu_flags;
+    key.param[0]    = param[0];
+    key.param[1]    = param[1];
+    key.srcPos      = srcPos;
+    key.dstPos      = dstPos;
+
+    buf = filter_cache_get(&key, outFilterSize);
+    if (buf) {
+        filter_size = (dstW + 3) * *outFilterSize * sizeof(**outFilter);
+        *filterPos  = av_malloc(pos_size);
+        *outFilter  = av_malloc(filter_size);
+        if (!*filterPos || !*outFilter) {
+            av_freep(filterPos);
+            av_freep(outFilter);
+            av_buffer_unref(&buf);
+            return AVERROR(ENOMEM);
+        }
+        memcpy(*filterPos, buf->data, pos_size);
+        memcpy(*outFilter, buf->data + pos_size, filter_size);
+        av_buffer_unref(&buf);
+        c->filter_cache_hits++;
+        return 0;
+    }
+
+    ret = compute_filter(outFilter, filterPos, outFilterSize, xInc,
+                         srcW, dstW, filterAlign, one, flags, cpu_flags,
+                         srcFilter, dstFilter, param, srcPos, dstPos);
+    if (ret < 0)
+        return ret;
+
+    // failing to cache the result is not an error
+    filter_size = (dstW + 3) * *outFilterSize * sizeof(**outFilter);
+    if (pos_size + filter_size > INT_MAX)
+        return 0;
+    buf = av_buffer_alloc(pos_size + filter_size);
+    if (buf) {
+        memcpy(buf->data, *filterPos, pos_size);
+        memcpy(buf->data + pos_size, *outFilter, filter_size);
+        filter_cache_add(&key, buf, *outFilterSize);
+    }
+
+    return 0;
+}
+
 static void fill_rgb2yuv_table(SwsContext *c, const int table[4], int dstRange)
 {
     int64_t W, V, Z, Cy, Cu, Cv;
@@ -860,6 +1022,15 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
     int need_reinit = 0;
+    int i;
+
+    for (i = 0; i < c->nb_slice_ctx; i++) {
+        int ret = sws_setColorspaceDetails(c->slice_ctx[i], inv_table, srcRange,
+                                           table, dstRange, brightness,
+                                           contrast, saturation);
+        if (ret < 0)
+            return ret;
+    }
 
     handle_formats(c);
     desc_dst = av_pix_fmt_desc_get(c->dstFormat);
@@ -1160,8 +1331,8 @@ static enum AVPixelFormat alphaless_fmt(enum AVPixelFormat fmt)
     }
 }
 
-av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
-                             SwsFilter *dstFilter)
+static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
+                                           SwsFilter *dstFilter)
 {
     int i;
     int usesVFilter, usesHFilter;
@@ -1671,7 +1842,7 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                     PPC_ALTIVEC(cpu_flags) ? 8 :
                                     have_neon(cpu_flags)   ? 8 : 1;
 
-            if ((ret = initFilter(&c->hLumFilter, &c->hLumFilterPos,
+            if ((ret = initFilter(c, &c->hLumFilter, &c->hLumFilterPos,
                            &c->hLumFilterSize, c->lumXInc,
                            srcW, dstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
@@ -1680,7 +1851,7 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                            get_local_pos(c, 0, 0, 0),
                            get_local_pos(c, 0, 0, 0))) < 0)
                 goto fail;
-            if ((ret = initFilter(&c->hChrFilter, &c->hChrFilterPos,
+            if ((ret = initFilter(c, &c->hChrFilter, &c->hChrFilterPos,
                            &c->hChrFilterSize, c->chrXInc,
                            c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1698,7 +1869,7 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                 PPC_ALTIVEC(cpu_flags) ? 8 :
                                 have_neon(cpu_flags)   ? 2 : 1;
 
-        if ((ret = initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
+        if ((ret = initFilter(c, &c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
                        c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                        cpu_flags, srcFilter->lumV, dstFilter->lumV,
@@ -1706,7 +1877,7 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                        get_local_pos(c, 0, 0, 1),
                        get_local_pos(c, 0, 0, 1))) < 0)
             goto fail;
-        if ((ret = initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
+        if ((ret = initFilter(c, &c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
                        c->chrYInc, c->chrSrcH, c->chrDstH,
                        filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1861,6 +2032,60 @@ fail: // FIXME replace things by appropriate error codes
     return -1;
 }
 
+static av_cold int context_init_threaded(SwsContext *c,
+                                         SwsFilter *srcFilter, SwsFilter *dstFilter)
+{
+    int i, ret;
+
+    ret = avpriv_slicethread_create(&c->slicethread, c, ff_sws_slice_worker,
+                                    NULL, c->nb_threads);
+    if (ret < 0)
+        return ret;
+
+    c->nb_threads = ret;
+    if (c->nb_threads <= 1) {
+        avpriv_slicethread_free(&c->slicethread);
+        return 0;
+    }
+
+    c->slice_ctx = av_mallocz_array(c->nb_threads, sizeof(*c->slice_ctx));
+    c->slice_err = av_mallocz_array(c->nb_threads, sizeof(*c->slice_err));
+    if (!c->slice_ctx || !c->slice_err)
+        return AVERROR(ENOMEM);
+
+    /* The same filters have to be used by all the contexts, so that the
+     * result does not depend on the number of threads. */
+    for (i = 0; i < c->nb_threads; i++) {
+        c->slice_ctx[i] = sws_alloc_context();
+        if (!c->slice_ctx[i])
+            return AVERROR(ENOMEM);
+        c->nb_slice_ctx++;
+
+        ret = av_opt_copy(c->slice_ctx[i], c);
+        if (ret < 0)
+            return ret;
+        c->slice_ctx[i]->nb_threads = 1;
+
+        ret = sws_init_single_context(c->slice_ctx[i], srcFilter, dstFilter);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
+                             SwsFilter *dstFilter)
+{
+    int ret;
+
+    ret = sws_init_single_context(c, srcFilter, dstFilter);
+    if (ret < 0 || c->nb_threads == 1 || !HAVE_THREADS)
+        return ret;
+
+    return context_init_threaded(c, srcFilter, dstFilter);
+}
+
 SwsContext *sws_alloc_set_opts(int srcW, int srcH, enum AVPixelFormat srcFormat,
                                int dstW, int dstH, enum AVPixelFormat dstFormat,
                                int flags, const double *param)
@@ -2312,6 +2537,12 @@ void sws_freeContext(SwsContext *c)
     if (!c)
         return;
 
+    avpriv_slicethread_free(&c->slicethread);
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+    av_freep(&c->slice_err);
+
     for (i = 0; i < 4; i++)
         av_freep(&c->dither_error[i]);
 
@@ -0,0 +1,210 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+#include <string.h>
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/samplefmt.h"
+
+#include "libswresample/swresample.h"
+#include "libswresample/resample.h"
+
+#include "checkasm.h"
+
+#define SRC_SAMPLES 1024
+#define DST_SAMPLES 256
+#define MIX_SAMPLES 256
+
+static void fill_samples(uint8_t *buf, enum AVSampleFormat fmt, int nb_samples)
+{
+    int i;
+
+    for (i = 0; i < nb_samples; i++) {
+        switch (fmt) {
+        case AV_SAMPLE_FMT_S16P:
+            // keep the sums of the filter taps in 32 bits
+            ((int16_t *)buf)[i] = (int)(rnd() & 0x3fff) - 0x2000;
+            break;
+        case AV_SAMPLE_FMT_S32P:
+            ((int32_t *)buf)[i] = (int)(rnd() & 0x3fffffff) - 0x20000000;
+            break;
+        case AV_SAMPLE_FMT_FLTP:
+            ((float *)buf)[i] = (float)rnd() / UINT_MAX - 0.5f;
+            break;
+        case AV_SAMPLE_FMT_DBLP:
+            ((double *)buf)[i] = (double)rnd() / UINT_MAX - 0.5;
+            break;
+        }
+    }
+}
+
+static int compare_samples(const uint8_t *a, const uint8_t *b,
+                           enum AVSampleFormat fmt, int nb_samples)
+{
+    switch (fmt) {
+    case AV_SAMPLE_FMT_FLTP:
+        return !float_near_abs_eps_array((const float *)a, (const float *)b,
+                                         FLT_EPSILON * 64, nb_samples);
+    case AV_SAMPLE_FMT_DBLP:
+        return !double_near_abs_eps_array((const double *)a, (const double *)b,
+                                          DBL_EPSILON * 64, nb_samples);
+    default:
+        return memcmp(a, b, nb_samples * av_get_bytes_per_sample(fmt));
+    }
+}
+
+static void check_resample(void)
+{
+    static const enum AVSampleFormat formats[] = {
+        AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32P,
+        AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_DBLP,
+    };
+    static const int filter_sizes[] = { 8, 13, 32 };
+    // padded, as the SIMD versions read whole registers past the last tap
+    LOCAL_ALIGNED_32(uint8_t, src, [(SRC_SAMPLES + 64) * sizeof(double)]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_SAMPLES * sizeof(double)]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_SAMPLES * sizeof(double)]);
+    int f, i, linear;
+
+    declare_func(int, ResampleContext *c, void *dst,
+                 const void *src, int n, int update_ctx);
+
+    for (f = 0; f < FF_ARRAY_ELEMS(formats); f++) {
+        const char *name = av_get_sample_fmt_name(formats[f]);
+        int bps = av_get_bytes_per_sample(formats[f]);
+
+        for (i = 0; i < FF_ARRAY_ELEMS(filter_sizes); i++) {
+            for (linear = 0; linear < 2; linear++) {
+                ResampleContext *c;
+
+                c = swri_resampler.init(NULL, 44100, 48000, filter_sizes[i], 10,
+                                        linear, 0.97, formats[f],
+                                        SWR_FILTER_TYPE_KAISER, 9, 20, 0, 1);
+                if (!c) {
+                    fail();
+                    continue;
+                }
+
+                // swr starts at a negative index, compensated by a shifted
+                // input buffer; start anywhere within the first input sample
+                c->index = rnd() % c->phase_count;
+                c->frac  = rnd() % c->src_incr;
+
+                memset(src, 0, (SRC_SAMPLES + 64) * sizeof(double));
+                fill_samples(src, formats[f], SRC_SAMPLES);
+
+                if (check_func(linear ? c->dsp.resample_linear : c->dsp.resample_common,
+                               "resample_%s_%s_%d", linear ? "linear" : "common",
+                               name, filter_sizes[i])) {
+                    memset(dst0, 0, DST_SAMPLES * bps);
+                    memset(dst1, 0, DST_SAMPLES * bps);
+
+                    call_ref(c, dst0, src, DST_SAMPLES, 0);
+                    call_new(c, dst1, src, DST_SAMPLES, 0);
+                    if (compare_samples(dst0, dst1, formats[f], DST_SAMPLES))
+                        fail();
+
+                    bench_new(c, dst1, src, DST_SAMPLES, 0);
+                }
+
+                swri_resampler.free(&c);
+            }
+        }
+    }
+
+    report("resample");
+}
+
+static void check_rematrix(void)
+{
+    static const enum AVSampleFormat formats[] = {
+        AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_FLTP,
+    };
+    LOCAL_ALIGNED_32(uint8_t, in1, [MIX_SAMPLES * sizeof(float)]);
+    LOCAL_ALIGNED_32(uint8_t, in2, [MIX_SAMPLES * sizeof(float)]);
+    LOCAL_ALIGNED_32(uint8_t, out0, [MIX_SAMPLES * sizeof(float)]);
+    LOCAL_ALIGNED_32(uint8_t, out1, [MIX_SAMPLES * sizeof(float)]);
+    int f;
+
+    for (f = 0; f < FF_ARRAY_ELEMS(formats); f++) {
+        const char *name = av_get_sample_fmt_name(formats[f]);
+        int bps = av_get_bytes_per_sample(formats[f]);
+        int nb_in  = av_get_channel_layout_nb_channels(AV_CH_LAYOUT_7POINT1);
+        // FC into both outputs, neither 0 nor 1 in the downmix matrix
+        int index1 = 2, index2 = nb_in + 2;
+        mix_1_1_func_type *mix_1_1;
+        mix_2_1_func_type *mix_2_1;
+        void *matrix;
+        SwrContext *s;
+
+        s = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_STEREO, formats[f], 48000,
+                               AV_CH_LAYOUT_7POINT1, formats[f], 48000, 0, NULL);
+        if (!s || swr_init(s) < 0) {
+            swr_free(&s);
+            fail();
+            continue;
+        }
+
+        // the SIMD versions take their own coefficient layout
+        mix_1_1 = s->mix_1_1_simd ? s->mix_1_1_simd : s->mix_1_1_f;
+        mix_2_1 = s->mix_2_1_simd ? s->mix_2_1_simd : s->mix_2_1_f;
+        matrix  = s->mix_2_1_simd ? s->native_simd_matrix : s->native_matrix;
+
+        fill_samples(in1, formats[f], MIX_SAMPLES);
+        fill_samples(in2, formats[f], MIX_SAMPLES);
+
+        if (check_func(mix_1_1, "mix_1_1_%s", name)) {
+            declare_func(void, void *out, const void *in, void *coeffp,
+                         integer index, integer len);
+
+            memset(out0, 0, MIX_SAMPLES * bps);
+            memset(out1, 0, MIX_SAMPLES * bps);
+            call_ref(out0, in1, s->native_matrix, index1, MIX_SAMPLES);
+            call_new(out1, in1, matrix, index1, MIX_SAMPLES);
+            if (compare_samples(out0, out1, formats[f], MIX_SAMPLES))
+                fail();
+            bench_new(out1, in1, matrix, index1, MIX_SAMPLES);
+        }
+
+        if (check_func(mix_2_1, "mix_2_1_%s", name)) {
+            declare_func(void, void *out, const void *in1, const void *in2,
+                         void *coeffp, integer index1, integer index2, integer len);
+
+            memset(out0, 0, MIX_SAMPLES * bps);
+            memset(out1, 0, MIX_SAMPLES * bps);
+            call_ref(out0, in1, in2, s->native_matrix, index1, index2, MIX_SAMPLES);
+            call_new(out1, in1, in2, matrix, index1, index2, MIX_SAMPLES);
+            if (compare_samples(out0, out1, formats[f], MIX_SAMPLES))
+                fail();
+            bench_new(out1, in1, in2, matrix, index1, index2, MIX_SAMPLES);
+        }
+
+        swr_free(&s);
+    }
+
+    report("rematrix");
+}
+
+void checkasm_check_sw_resample(void)
+{
+    check_resample();
+    check_rematrix();
+}
@@ -0,0 +1,177 @@
+/*
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#include "checkasm.h"
+
+#define randomize_buffers(buf, size)      \
+    do {                                  \
+        int j;                            \
+        for (j = 0; j < size; j += 4)     \
+            AV_WN32(buf + j, rnd());      \
+    } while (0)
+
+#define SRC_PIXELS 512
+#define DST_PIXELS 256
+#define MAX_FILTER_WIDTH 40
+#define MAX_VFILTER_WIDTH 16
+
+static void check_hscale(void)
+{
+    static const int filter_sizes[] = { 4, 8, 12, 16, 40 };
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, dst0, [DST_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, dst1, [DST_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, filter, [DST_PIXELS * MAX_FILTER_WIDTH]);
+    LOCAL_ALIGNED_32(int32_t, filter_pos, [DST_PIXELS]);
+    struct SwsContext *ctx;
+    int i, j, k;
+
+    declare_func(void, SwsContext *c, int16_t *dst, int dstW,
+                 const uint8_t *src, const int16_t *filter,
+                 const int32_t *filterPos, int filterSize);
+
+    ctx = sws_getContext(16, 16, AV_PIX_FMT_YUV420P, 16, 16, AV_PIX_FMT_YUV420P,
+                         SWS_BILINEAR, NULL, NULL, NULL);
+    if (!ctx)
+        fail();
+
+    for (i = 0; i < FF_ARRAY_ELEMS(filter_sizes); i++) {
+        int width = filter_sizes[i];
+
+        ctx->dstW = ctx->chrDstW = DST_PIXELS;
+        ctx->hLumFilterSize = ctx->hChrFilterSize = width;
+        ff_getSwsFunc(ctx);
+
+        randomize_buffers(src, SRC_PIXELS);
+        for (j = 0; j < DST_PIXELS; j++) {
+            int16_t *coeffs = filter + j * width;
+            int total = 0, sum = 0;
+
+            filter_pos[j] = rnd() % (SRC_PIXELS - width + 1);
+            // random coefficients normalized to add up to 1 << 14, like the ones of a real filter
+            for (k = 0; k < width; k++)
+                total += coeffs[k] = (rnd() & 0xfff) + 1;
+            for (k = 0; k < width; k++)
+                sum += coeffs[k] = coeffs[k] * (1 << 14) / total;
+            coeffs[0] += (1 << 14) - sum;
+        }
+
+        if (check_func(ctx->hyScale, "hscale_8_to_15_%d", width)) {
+            memset(dst0, 0, DST_PIXELS * sizeof(*dst0));
+            memset(dst1, 0, DST_PIXELS * sizeof(*dst1));
+
+            call_ref(ctx, dst0, DST_PIXELS, src, filter, filter_pos, width);
+            call_new(ctx, dst1, DST_PIXELS, src, filter, filter_pos, width);
+            if (memcmp(dst0, dst1, DST_PIXELS * sizeof(*dst0)))
+                fail();
+
+            bench_new(ctx, dst1, DST_PIXELS, src, filter, filter_pos, width);
+        }
+    }
+
+    sws_freeContext(ctx);
+    report("hscale");
+}
+
+static void check_yuv2planeX(void)
+{
+    static const enum AVPixelFormat formats[] = {
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P9LE, AV_PIX_FMT_YUV420P10LE,
+    };
+    static const int filter_sizes[] = { 2, 4, 8, 16 };
+    static const int widths[] = { 16, 40, DST_PIXELS };
+    LOCAL_ALIGNED_32(int16_t, src_pixels, [MAX_VFILTER_WIDTH * DST_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, filter, [MAX_VFILTER_WIDTH]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_PIXELS * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_PIXELS * 2]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+    const int16_t *src[MAX_VFILTER_WIDTH];
+    int f, i, j, w, offset;
+
+    declare_func(void, const int16_t *filter, int filterSize,
+                 const int16_t **src, uint8_t *dest, int dstW,
+                 const uint8_t *dither, int offset);
+
+    for (i = 0; i < MAX_VFILTER_WIDTH; i++)
+        src[i] = src_pixels + i * DST_PIXELS;
+
+    for (f = 0; f < FF_ARRAY_ELEMS(formats); f++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(formats[f]);
+        struct SwsContext *ctx;
+
+        // accurate rounding, as the MMX vertical filter takes its own coefficient layout
+        ctx = sws_getContext(16, 16, formats[f], 16, 16, formats[f],
+                             SWS_BILINEAR | SWS_ACCURATE_RND, NULL, NULL, NULL);
+        if (!ctx)
+            fail();
+
+        for (w = 0; w < FF_ARRAY_ELEMS(widths); w++) {
+            int dstW = widths[w];
+
+            ctx->dstW = ctx->chrDstW = dstW;
+            ff_getSwsFunc(ctx);
+
+            for (i = 0; i < FF_ARRAY_ELEMS(filter_sizes); i++) {
+                int filter_size = filter_sizes[i];
+
+                for (j = 0; j < MAX_VFILTER_WIDTH * DST_PIXELS; j++)
+                    src_pixels[j] = rnd() & 0x7fff;
+                for (j = 0; j < filter_size; j++)
+                    filter[j] = (int)(rnd() & 0xfff) - 0x400;
+                randomize_buffers(dither, 8);
+                offset = rnd() & 1 ? 3 : 0;
+
+                if (check_func(ctx->yuv2planeX, "yuv2planeX_%d_%d_%d",
+                               desc->comp[0].depth, filter_size, dstW)) {
+                    int size = dstW * (desc->comp[0].depth > 8 ? 2 : 1);
+
+                    memset(dst0, 0, DST_PIXELS * 2);
+                    memset(dst1, 0, DST_PIXELS * 2);
+
+                    call_ref(filter, filter_size, src, dst0, dstW, dither, offset);
+                    call_new(filter, filter_size, src, dst1, dstW, dither, offset);
+                    if (memcmp(dst0, dst1, size))
+                        fail();
+
+                    bench_new(filter, filter_size, src, dst1, dstW, dither, offset);
+                }
+            }
+        }
+
+        sws_freeContext(ctx);
+    }
+
+    report("yuv2planeX");
+}
+
+void checkasm_check_sw_scale(void)
+{
+    check_hscale();
+    check_yuv2planeX();
+}
@@ -83,6 +83,19 @@ fate-filter-testsrc2-rgb24: CMD = framecrc -lavfi testsrc2=r=7:d=10 -pix_fmt rgb
 FATE_FILTER-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER) += fate-filter-testsrc2-rgba
 fate-filter-testsrc2-rgba: CMD = framecrc -lavfi testsrc2=r=7:d=10 -pix_fmt rgba
 
+UNSCALED_CONVERSIONS = p010le-yuv420p10le p016le-yuv420p16le yuv420p10le-nv12 \
+                       yuv420p12le-nv21 p010le-nv12 p016le-yuv420p            \
+                       nv12-p010le nv21-yuv420p10le
+
+define FATE_UNSCALED_SUITE
+FATE_FILTER_UNSCALED += fate-filter-unscaled-$(1)-$(2)
+fate-filter-unscaled-$(1)-$(2): CMD = framecrc -lavfi testsrc2=s=352x288:r=7:d=1,scale=320x240,format=$(1) -pix_fmt $(2)
+endef
+
+$(foreach CONV,$(UNSCALED_CONVERSIONS),$(eval $(call FATE_UNSCALED_SUITE,$(word 1,$(subst -, ,$(CONV))),$(word 2,$(subst -, ,$(CONV))))))
+fate-filter-unscaled: $(FATE_FILTER_UNSCALED)
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER SCALE_FILTER FORMAT_FILTER) += $(FATE_FILTER_UNSCALED)
+
 FATE_FILTER-$(call ALLYES, LAVFI_INDEV ALLRGB_FILTER) += fate-filter-allrgb
 fate-filter-allrgb: CMD = framecrc -lavfi allrgb=rate=5:duration=1 -pix_fmt rgb24
 
@@ -793,6 +806,13 @@ fate-filter-refcmp-ssim-rgb: CMD = refcmp_metadata ssim rgb24 0.015
 FATE_FILTER_SAMPLES-$(call ALLYES, $(REFCMP_DEPS) SSIM_FILTER) += fate-filter-refcmp-ssim-yuv
 fate-filter-refcmp-ssim-yuv: CMD = refcmp_metadata ssim yuv422p 0.015
 
+FATE_FILTER_SAMPLES-$(call ALLYES, $(REFCMP_DEPS) QUALITY_FILTER) += fate-filter-refcmp-quality-yuv
+fate-filter-refcmp-quality-yuv: CMD = refcmp_metadata quality yuv422p 0.015
+
+FATE_FILTER-$(CONFIG_TONEMAP_FILTER) += fate-filter-tonemap-lut
+fate-filter-tonemap-lut: libavfilter/tests/tonemap$(EXESUF)
+fate-filter-tonemap-lut: CMD = run libavfilter/tests/tonemap
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
@@ -6,6 +6,12 @@ FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/tests/noproxy$(EXESUF)
 fate-noproxy: CMD = run libavformat/tests/noproxy
 
+ifeq ($(HAVE_THREADS),yes)
+FATE_LIBAVFORMAT-$(call ALLYES, HTTP_PROTOCOL TCP_PROTOCOL) += fate-http-pool
+endif
+fate-http-pool: libavformat/tests/http_pool$(EXESUF)
+fate-http-pool: CMD = run libavformat/tests/http_pool
+
 FATE_LIBAVFORMAT-$(CONFIG_FFRTMPCRYPT_PROTOCOL) += fate-rtmpdh
 fate-rtmpdh: libavformat/tests/rtmpdh$(EXESUF)
 fate-rtmpdh: CMD = run libavformat/tests/rtmpdh
@@ -1094,5 +1094,27 @@ fate-swr-audioconvert: CMP = stddev
 fate-swr-audioconvert: FUZZ = 0
 
 FATE_SWR += $(FATE_SWR_AUDIOCONVERT-yes)
+
+# the threaded resampler must give the same output as the single threaded one
+define ARESAMPLE_THREADS
+FATE_SWR_THREADS += fate-swr-resample_threads-$(1)-$(3)
+fate-swr-resample_threads-$(1)-$(3): tests/data/asynth-44100-6.wav
+fate-swr-resample_threads-$(1)-$(3): CMD = framemd5 -i $(TARGET_PATH)/tests/data/asynth-44100-6.wav -af aresample=48000:internal_sample_fmt=$(1):resample_threads=$(3) -c:a pcm_$(2)
+fate-swr-resample_threads-$(1)-$(3): REF = $(SRC_PATH)/tests/ref/fate/swr-resample_threads-$(1)
+endef
+
+$(foreach T,1 2 4 6,$(eval $(call ARESAMPLE_THREADS,s16p,s16le,$(T))))
+$(foreach T,1 2 4 6,$(eval $(call ARESAMPLE_THREADS,fltp,f32le,$(T))))
+
+FATE_SWR_THREADS-$(call FILTERDEMDECENCMUX, ARESAMPLE, WAV, PCM_S16LE, PCM_F32LE, FRAMEMD5) += $(FATE_SWR_THREADS)
+fate-swr-resample_threads: $(FATE_SWR_THREADS-yes)
+FATE_SWR += $(FATE_SWR_THREADS-yes)
 FATE_FFMPEG += $(FATE_SWR)
-fate-swr: $(FATE_SWR)
+
+# fixed delay block mode: split conversion, impulse delay and out_count check
+FATE_LIBSWRESAMPLE += fate-swr-block
+fate-swr-block: libswresample/tests/swresample$(EXESUF)
+fate-swr-block: CMD = run libswresample/tests/swresample block
+FATE-$(CONFIG_SWRESAMPLE) += $(FATE_LIBSWRESAMPLE)
+
+fate-swr: $(FATE_SWR) $(FATE_LIBSWRESAMPLE)
@@ -1,7 +1,15 @@
+FATE_LIBSWSCALE += fate-sws-filter-cache
+fate-sws-filter-cache: libswscale/tests/filter_cache$(EXESUF)
+fate-sws-filter-cache: CMD = run libswscale/tests/filter_cache
+
 FATE_LIBSWSCALE += fate-sws-pixdesc-query
 fate-sws-pixdesc-query: libswscale/tests/pixdesc_query$(EXESUF)
 fate-sws-pixdesc-query: CMD = run libswscale/tests/pixdesc_query
 
+FATE_LIBSWSCALE += fate-sws-scale-frame
+fate-sws-scale-frame: libswscale/tests/scale_frame$(EXESUF)
+fate-sws-scale-frame: CMD = run libswscale/tests/scale_frame
+
 FATE_LIBSWSCALE += $(FATE_LIBSWSCALE-yes)
 FATE-$(CONFIG_SWSCALE) += $(FATE_LIBSWSCALE)
 fate-libswscale: $(FATE_LIBSWSCALE)
@@ -0,0 +1,137 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the demuxing throughput of a MPEG-TS capture when only some of its
+ * programs are wanted, e.g.:
+ *     make tools/tsdemux_bench
+ *     tools/tsdemux_bench -k 2 -r 5 capture.ts
+ *
+ * A multi-program test file can be created with something like:
+ *     ffmpeg -f lavfi -i testsrc -f lavfi -i testsrc -f lavfi -i testsrc \
+ *            -map 0 -map 1 -map 2 -c:v mpeg2video -t 60                  \
+ *            -program st=0 -program st=1 -program st=2 capture.ts
+ */
+
+#include "config.h"
+#if HAVE_UNISTD_H
+#include <unistd.h>             /* getopt */
+#endif
+
+#include "libavformat/avformat.h"
+#include "libavutil/time.h"
+
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+static void usage(int ret)
+{
+    fprintf(ret ? stderr : stdout,
+            "Usage: tsdemux_bench [-k programs] [-r runs] file\n"
+            "    -k N  keep the first N programs and discard the others (default 2, 0 keeps all)\n"
+            "    -r N  number of runs, the fastest one is reported (default 3)\n"
+            );
+    exit(ret);
+}
+
+static int run(const char *filename, int keep, int64_t *packets, int64_t *bytes,
+               int64_t *file_size, int64_t *time)
+{
+    AVFormatContext *avf = NULL;
+    AVPacket pkt;
+    int64_t start;
+    int i, j, ret;
+
+    *packets = *bytes = 0;
+    start = av_gettime_relative();
+
+    if ((ret = avformat_open_input(&avf, filename, av_find_input_format("mpegts"), NULL)) < 0) {
+        fprintf(stderr, "%s: %s\n", filename, av_err2str(ret));
+        return ret;
+    }
+
+    /* The PMTs are only known after some packets were read, so the discard
+     * flags are updated whenever new programs show up. A program is only
+     * discarded once its PMT was parsed, as its streams would otherwise never
+     * be associated with it. */
+    for (;;) {
+        for (i = keep ? keep : avf->nb_programs; i < avf->nb_programs; i++) {
+            AVProgram *prg = avf->programs[i];
+            if (!prg->nb_stream_indexes)
+                continue;
+            prg->discard = AVDISCARD_ALL;
+            for (j = 0; j < prg->nb_stream_indexes; j++)
+                avf->streams[prg->stream_index[j]]->discard = AVDISCARD_ALL;
+        }
+
+        ret = av_read_frame(avf, &pkt);
+        if (ret < 0)
+            break;
+        if (avf->streams[pkt.stream_index]->discard < AVDISCARD_ALL) {
+            (*packets)++;
+            *bytes += pkt.size;
+        }
+        av_packet_unref(&pkt);
+    }
+
+    *time      = av_gettime_relative() - start;
+    *file_size = avio_size(avf->pb);
+    avformat_close_input(&avf);
+
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+int main(int argc, char **argv)
+{
+    int opt, ret, i, keep = 2, runs = 3;
+    int64_t packets, bytes, file_size, time, best = INT64_MAX;
+    const char *filename;
+
+    while ((opt = getopt(argc, argv, "hk:r:")) != -1) {
+        switch (opt) {
+        case 'k':
+            keep = atoi(optarg);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        case 'h':
+            usage(0);
+        default:
+            usage(1);
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 1 || keep < 0 || runs < 1)
+        usage(1);
+    filename = argv[0];
+
+    for (i = 0; i < runs; i++) {
+        if ((ret = run(filename, keep, &packets, &bytes, &file_size, &time)) < 0)
+            return 1;
+        best = FFMIN(best, time);
+    }
+
+    printf("%s: %"PRId64" packets, %"PRId64" bytes kept, %.3f s, %.1f MB/s\n",
+           filename, packets, bytes, best / 1000000.0,
+           file_size / (double)FFMAX(best, 1));
+
+    return 0;
+}